@@ -39,16 +39,10 @@
 
 
 
-std::mutex mux;
-std::condition_variable cvvv;
-cv::Mat frame;
-float target_quality = 35;
-std::vector<uchar> bytes;
-bool ready = false;
-bool processed = false;
+std::atomic<float> target_quality{ 35 };    // PSNR [dB] of lossy encoded camera frames (keys M, N)
 bool show_imgui = false;
 
-void lossy_quality_limit_thread();
+int lossy_quality_limit(const cv::Mat& frame, std::vector<uchar>& bytes);
 
 
 
@@ -62,11 +56,13 @@ App::App()
 void App::init_audio() {
     if (ma_engine_init(NULL, &audio_engine) != MA_SUCCESS) {
         std::cerr << "Failed to initialize audio engine!" << std::endl;
+        return;
     }
+    audio_is_init = true;
 }
 
 void App::play_audio() {
-    if (!music_is_run) {
+    if (audio_is_init && !music_is_run) {
         ma_engine_start(&audio_engine);
         if(!music_is_init)
         {
@@ -87,7 +83,9 @@ void App::stop_audio() {
 }
 
 void App::destroy_audio() {
-    ma_engine_uninit(&audio_engine);
+    if (audio_is_init)
+        ma_engine_uninit(&audio_engine);
+    audio_is_init = false;
 }
 
 void App::init_opencv()
@@ -95,77 +93,126 @@ void App::init_opencv()
     // ...
 }
 
-void App::play_if_color() 
+// raw YUYV frame as 2-channel image (some backends deliver one row of bytes), empty if it is not YUYV
+static cv::Mat yuyv_view(const cv::Mat& raw, const cv::Size size)
 {
-    cv::cvtColor(frame, scene_hsv, cv::COLOR_BGR2HSV);
-
-    cv::Scalar lower_threshold = cv::Scalar(128.0, 128.0, 128.0);
-    cv::Scalar upper_threshold = cv::Scalar(255.0, 255.0, 255.0);
-
-    cv::inRange(scene_hsv, lower_threshold, upper_threshold, scene_threshold);
-    int number_of_pixels = 0;
-
-    for (int y = 0; y < scene_threshold.rows; y++)
-    {
-        for (int x = 0; x < scene_threshold.cols; x++)
-        {
-            // load source pixel
-            //cv::Vec3b pixel = scene_threshold.at<cv::Vec3b>(y, x);
-            int number_of_color_pixels_xy = (int)scene_threshold.at<uchar>(y, x);
-
-            number_of_pixels = number_of_color_pixels_xy + number_of_pixels;
-        }
-    }
-
-    auto this_inst = static_cast<App*>(glfwGetWindowUserPointer(window));
-
-    if (number_of_pixels > 0)
-        this_inst->play_audio();
-    else
-        this->stop_audio();
+    if (raw.type() == CV_8UC2)
+        return raw;
+    if (raw.total() * raw.elemSize() == size_t(size.area()) * 2)
+        return cv::Mat(size, CV_8UC2, raw.data);
+    return cv::Mat();
 }
 
-void App::start_capture_thread()
+void App::init_camera_pipeline()
 {
-    std::thread([this]() {
-        while (!glfwWindowShouldClose(window))
-        {
-            {
-                std::lock_guard<std::mutex> lock(mux);
-                capture >> frame;
+    // capture: čte zdroj (kamera/video/...), tempo určuje zdroj; surový snímek rovnou do PBO pro náhled,
+    // aby zobrazení nečekalo na další stupně
+    // size = zjištěná velikost YUYV snímku, zdroj se ptá jen při první / změněné velikosti
+    camera_pipeline.add_stage("capture", [this, size = cv::Size()](CameraFrame& frame) mutable {
+        if (!source->read(frame.image)) {
+            std::this_thread::sleep_for(source->frame_period());    // zařízení nedodává, zkusit znovu za snímek
+            return false;
+        }
+        frame.timestamp = source->timestamp();
+        frame.sequence = ++captured_frames;
+        if (frame.sequence == 30)
+            frame_pool.mark_warm_up();     // po zahřátí mají všechny buffery správnou velikost
+
+        frame.yuyv = frame.image.channels() != 3;
+        if (!frame.yuyv) {
+            frame.size = frame.image.size();
+            camera_texture.write(frame.image.data, frame.image.cols, frame.image.rows, frame.image.step, CameraTexture::Format::BGR, frame.timestamp);
+        }
+        else {
+            cv::Mat yuyv = yuyv_view(frame.image, size);
+            if (yuyv.empty()) {
+                size = source->size();
+                yuyv = yuyv_view(frame.image, size);
             }
+            if (yuyv.empty())
+                return false;   // neznámý formát
+            frame.size = yuyv.size();
+            camera_texture.write(yuyv.data, yuyv.cols, yuyv.rows, yuyv.step, CameraTexture::Format::YUYV, frame.timestamp);
+        }
+        return true;
+    });
+
+    // convert: BGR pro analýzu (BGR zdroj se jen sdílí, YUYV se převede)
+    // (jen detekce na GPU bez kódování: BGR nikdo nečte, převod se vynechá)
+    camera_pipeline.add_stage("convert", [this](CameraFrame& frame) {
+        frame.bgr_ready = !frame.yuyv || detection_backend != DetectionBackend::GPU || encode_on;
+        if (!frame.yuyv)
+            frame.bgr = frame.image;
+        else if (frame.bgr_ready)
+            cv::cvtColor(yuyv_view(frame.image, frame.size), frame.bgr, cv::COLOR_YUV2BGR_YUYV);
+        return true;
+    });
+
+    // analyze: detekce barvy, výsledek rovnou render threadu (nečeká na encode)
+    camera_pipeline.add_stage("analyze", [this](CameraFrame& frame) {
+        if (detection_backend == DetectionBackend::GPU || !frame.bgr_ready) {
+            color_tracker.reset();      // relocks by a full scan once the CPU backend is back
+            return true;    // compute shader on camera_texture instead, see run()
+        }
 
-            if (frame.empty()) {
-                std::cerr << "device closed (or video at the end)" << '\n';
-                break;
+        DetectionResult& result = detections.write_buffer();
+        if (tracking_on) {
+            // sledování: jen okno kolem poslední polohy, celý snímek až při ztrátě
+            const int tracked = tracked_class;
+            if (tracked != color_tracker.class_index) {
+                color_tracker.class_index = tracked;
+                color_tracker.reset();
             }
-
-            
-            lossy_quality_limit_thread();
-            play_if_color();
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(30)); // kamera 30 FPS
+            result.track = color_tracker.update(color_classifier, color_detector, frame.bgr, color_coarse_step, result.detection);
         }
-        }).detach(); // oddělené vlákno
-}
-
-void App::camera_loop()
-{
-    while (camera_running) {
-        cv::Mat frame_local;
-        if (capture.read(frame_local)) {
-            std::lock_guard<std::mutex> lock(mux);
-            frame = frame_local.clone();
+        else {
+            // všechny třídy barev jedním průchodem, po dlaždicích na workers (volitelně nejdřív hrubě)
+            result.detection = color_detector.detect(color_classifier, frame.bgr, color_coarse_step);
+            result.track = ColorTrack();
+            color_tracker.reset();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10)); // malá pauza
-    }
+        result.sequence = frame.sequence;
+        result.timestamp = frame.timestamp;
+        result.analyzed = std::chrono::steady_clock::now();
+        result.frame_size = frame.bgr.size();
+        detections.publish();
+        return true;
+    });
+
+    // encode: JPEG s nejnižší kvalitou splňující target_quality (PSNR), volitelné
+    camera_pipeline.add_stage("encode", [this](CameraFrame& frame) {
+        frame.jpeg.clear();
+        if (encode_on && frame.bgr_ready)
+            frame.jpeg_quality = lossy_quality_limit(frame.bgr, frame.jpeg);
+        return true;
+    });
+
+    // sinks: výstup zakódovaného snímku (zatím jen statistika pro ImGui)
+    camera_pipeline.add_stage("sinks", [this](CameraFrame& frame) {
+        jpeg_bytes = frame.jpeg.size();
+        jpeg_quality = frame.jpeg_quality;
+        return true;
+    });
 }
 
 
 
-bool App::init()
+bool App::init(int argc, char* argv[])
 {
     try {
+        // app options (--latency-log FILE), the rest selects the frame source
+        std::vector<char*> source_args{ argv[0] };
+        for (int i = 1; i < argc; i++) {
+            if (std::string(argv[i]) == "--latency-log" && i + 1 < argc)
+                latency_log_path = argv[++i];
+            else
+                source_args.push_back(argv[i]);
+        }
+
+        // frame source first, wrong arguments fail before anything else starts
+        source = FrameSource::from_args(int(source_args.size()), source_args.data());
+        std::cout << "Frame source: " << source->describe() << (source->realtime ? "" : ", no pacing") << '\n';
+
         std::cout << "Current working directory: " << std::filesystem::current_path().generic_string() << '\n';
 
         if (!std::filesystem::exists("bin"))
@@ -179,15 +226,13 @@ bool App::init()
         init_glew();
         init_audio();
         init_gl_debug();
+        ShaderProgram::init_parallel_compile();
 
         print_opencv_info();
         print_glfw_info();
         print_gl_info();
         print_glm_info();
 
-        camera_thread = std::thread(&App::camera_loop, this);
-
-
         if (!GLEW_ARB_direct_state_access)
             throw std::runtime_error("No DSA :-(");
 
@@ -204,21 +249,51 @@ bool App::init()
         init_imgui();
 
 
-        glEnable(GL_DEPTH_TEST);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl_state.enable(GL_DEPTH_TEST, true);
+        gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 
-        capture = cv::VideoCapture(0, cv::CAP_ANY);
-        if (!capture.isOpened())
-            throw std::runtime_error("Can not open camera :(");
+        // surová data z kamery (bez převodu barev v OpenCV), pokud je zdroj umí dodat
+        if (camera_yuyv) {
+            camera_yuyv = source->request_raw_yuyv();
+            std::cout << "Camera format: " << (camera_yuyv ? "raw YUYV (GPU conversion)" : "BGR") << '\n';
+        }
 
-        std::cout << "Cam opened successfully.\n";
+        // předalokované buffery snímků (BGR, HSV, maska), recyklují se místo alokace každý snímek
+        int camera_width = source->size().width, camera_height = source->size().height;
+        if (camera_width <= 0 || camera_height <= 0) {
+            camera_width = 1920;
+            camera_height = 1080;
+        }
+        // stupně capture -> convert -> analyze -> encode -> sinks, každý ve vlastním vlákně
+        color_classifier = ColorClassifier(std::filesystem::exists("resources/color_classes.txt") ?
+            ColorClassifier::load("resources/color_classes.txt") : ColorClassifier::defaults());
+        init_camera_pipeline();
+
+        // snímek pipeline: image, vlastní bgr jen u YUYV (BGR zdroj ho sdílí s image)
+        const int blocks_per_frame = camera_yuyv ? 2 : 1;
+        frame_pool.reserve(size_t(camera_width) * camera_height * 3, int(camera_pipeline.frames_needed()) * blocks_per_frame);
+
+        // pipeline starts only when the camera is opened and configured
+        camera_pipeline.start([&](CameraFrame& frame) {
+            frame_pool.attach(frame.image);
+            frame_pool.attach(frame.bgr);
+            if (!camera_yuyv)
+                frame.image.create(camera_height, camera_width, CV_8UC3);
+        });
+
+        // latence kamery: capture -> upload -> present
+        latency_epoch = std::chrono::steady_clock::now();
+        if (!latency_log_path.empty()) {
+            latency_log.open(latency_log_path);
+            if (latency_log)
+                latency_log << "frame,captured_ms,device_ms,capture_to_upload_ms,capture_to_present_ms\n";
+            else
+                std::cerr << "Can not write " << latency_log_path << ", latency is shown in ImGui only\n";
+        }
 
-        glGenTextures(1, &camera_texture);
-        glBindTexture(GL_TEXTURE_2D, camera_texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // camera texture is created with the first frame (immutable storage needs its size), see CameraTexture.hpp
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // cv::Mat BGR rows are tightly packed
 
     }
     catch (std::exception const& e) {
@@ -323,21 +398,41 @@ void App::init_assets(void) {
     // Initialize pipeline: compile, link and use shaders
     //
 
-    shader = ShaderProgram("resources/lighting.vert", "resources/lighting.frag");
+    // permutations are built by get() the first time a draw selects their feature mask,
+    // compile/link errors are reported at first activate()
+    lighting_shaders = ShaderVariants("resources/lighting.vert", "resources/lighting.frag", lighting_feature_names, ~FEATURE_DEFERRED);
+    depth_shaders = ShaderVariants("resources/lighting.vert", "resources/depth.frag", lighting_feature_names, FEATURE_INSTANCED);
+    gbuffer_shaders = ShaderVariants("resources/lighting.vert", "resources/gbuffer.frag", lighting_feature_names, FEATURE_TEXTURE | FEATURE_INSTANCED);
+    shadow_shaders = ShaderVariants("resources/lighting.vert", "resources/depth.frag", lighting_feature_names, 0);
+    deferred_shaders = ShaderVariants("resources/deferred.vert", "resources/lighting.frag", lighting_feature_names,
+        FEATURE_DIRLIGHT | FEATURE_SPECULAR | FEATURE_SPOTLIGHT | FEATURE_CLUSTERED | FEATURE_DEFERRED);
 
     // Model 1 – kostka
-    Model cube_model("./obj/cube_triangles_vnt.obj", shader, "resources/tex_beton.jpg");
+    Model cube_model("./obj/cube_triangles_vnt.obj", textures, "resources/tex_beton.jpg");
     scene.insert({ "cube", cube_model });
 
     // Model 2 – koule
-    Model sphere_model("./obj/sphere_tri_vnt.obj", shader, "resources/tex_drevo.jpg");
+    Model sphere_model("./obj/sphere_tri_vnt.obj", textures, "resources/tex_drevo.jpg");
     scene.insert({ "sphere", sphere_model });
 
     // Model 3 – kostka
-    Model cube_modelalfa("./obj/cube_triangles_vnt.obj", shader, "resources/sklo.png");
+    Model cube_modelalfa("./obj/cube_triangles_vnt.obj", alpha_textures, "resources/sklo.png");
     scene.insert({ "cubealfa", cube_modelalfa });
 
-    
+    // all textures queued (decoded by worker threads) -> one GL_TEXTURE_2D_ARRAY, layers arrive during first frames
+    textures.upload();
+    alpha_textures.upload();
+    residency.add(textures);
+    residency.add(alpha_textures);
+
+    // neprůhledné modely do jednoho batche (geometrie + instance), kreslí se jedním voláním
+    for (auto const& name : { "cube", "sphere" }) {
+        for (auto const& mesh : scene[name].meshes) {
+            unsigned m = opaque_batch.add_mesh(mesh.getVertices(), mesh.getIndices());
+            batch_instances[name].push_back(opaque_batch.add_instance(m, mesh.texture_layer));
+        }
+    }
+    opaque_batch.build();
 }
 
 void App::glfw_error_callback(int error, const char* description)
@@ -357,10 +452,10 @@ void App::glfw_key_callback(GLFWwindow* window, int key, int scancode, int actio
             glfwSetWindowShouldClose(window, GLFW_TRUE);
             break;
         case GLFW_KEY_M:
-            target_quality += 1;
+            target_quality = target_quality + 1;
             break;
         case GLFW_KEY_N:
-            target_quality -= 1;
+            target_quality = target_quality - 1;
             break;
         case GLFW_KEY_V:
             // Vsync on/off
@@ -628,11 +723,9 @@ void App::print_gl_info()
 }
 
 
-void lossy_quality_limit_thread()
+// lowest JPEG quality with PSNR >= target_quality, returns the quality
+int lossy_quality_limit(const cv::Mat& frame, std::vector<uchar>& bytes)
 {
-    std::scoped_lock lock(mux);
-    cv::Mat frame2;
-    frame.copyTo(frame2);
 
     std::string suff(".jpg"); // target format
     if (!cv::haveImageWriter(suff))
@@ -649,7 +742,10 @@ void lossy_quality_limit_thread()
     //std::cout << '[';
 
     //try step-by-step to decrease quality by 5%, until it fits into limit
+    const float target = target_quality;
+    int quality = 0;
     for (auto i = 0; i < 100; i += 5) {
+        quality = i;
         compression_params = compression_params_template; // reset parameters
         compression_params.push_back(i);                  // set desired quality
 
@@ -660,15 +756,14 @@ void lossy_quality_limit_thread()
         //std::cout << cv::PSNR(frame, cv::imdecode(bytes, cv::IMREAD_ANYCOLOR)) << ',';
 
         //if quality is larger: it is our output
-        if (cv::PSNR(frame, cv::imdecode(bytes, cv::IMREAD_ANYCOLOR)) >= (target_quality))
+        if (cv::PSNR(frame, cv::imdecode(bytes, cv::IMREAD_ANYCOLOR)) >= (target))
             break; // ok, done
     }
 
     //ggggg
     //std::cout << "]\n";
 
-    processed = true;
-    cvvv.notify_one();
+    return quality;
 }
 
 int App::run(void)
@@ -688,8 +783,6 @@ int App::run(void)
         // Clear color saved to OpenGL state machine: no need to set repeatedly in game loop
         glClearColor(0, 0, 0, 0);
 
-        shader.activate();
-
         //while (capture.isOpened())
         while (!glfwWindowShouldClose(window))
         {
@@ -706,14 +799,210 @@ int App::run(void)
 
                 ImGui::Text("V-Sync: %s", is_vsync_on ? "ON" : "OFF");
                 ImGui::Text("FPS: %.1f", FPS);
+                ImGui::Text("Scene GPU time: %.3f ms", scene_timer.ms());
+                if (textures.layers_pending() + alpha_textures.layers_pending() > 0)
+                    ImGui::Text("Loading textures: %d of %d", textures.layers() + alpha_textures.layers() - textures.layers_pending() - alpha_textures.layers_pending(),
+                        textures.layers() + alpha_textures.layers());
+                ImGui::Text("Texture memory: %.1f MB", residency.resident_bytes() / (1024.0 * 1024.0));
+                ImGui::Text("GL state calls: %lu issued, %lu skipped", gl_state.last_frame_issued, gl_state.last_frame_skipped);
                 ImGui::Text("(press RMB to release mouse)");
                 ImGui::Text("(hit I to show/hide info)");
                 ImGui::Separator();
                 ImGui::SliderFloat("Spotlight intensity", &spotlight_intensity, 0.0f, 1.0f);
+                ImGui::Checkbox("Directional light", &dirlight_on);
+                ImGui::SameLine();
+                ImGui::Checkbox("Specular", &specular_on);
+                ImGui::Checkbox("Batching (multi-draw indirect)", &batching_on);
+                ImGui::Checkbox("Animate", &animate_on);
+                ImGui::SameLine();
+                ImGui::Text("Shadow map renders: %lu", dir_shadow.renders + spot_shadow.renders);
+                ImGui::Combo("Render path", &render_path, "Forward\0Forward + depth pre-pass\0Deferred\0");
+                ImGui::Checkbox("Clustered lights", &clustered_on);
+                ImGui::SliderInt("Point lights", &point_light_count, 0, 1024);
+                ImGui::SliderFloat("Point light intensity", &point_light_intensity, 0.0f, 1.0f);
+                ImGui::Text("Light-cluster pairs: %zu", light_clusters.assigned());
+
+                if (ImGui::CollapsingHeader("Texture residency")) {
+                    ImGui::SliderInt("Budget (MB)", &texture_budget_mb, 1, 256);
+                    ImGui::Text("Resident: %.1f of %d MB (all levels: %.1f MB)", residency.resident_bytes() / (1024.0 * 1024.0), texture_budget_mb,
+                        (textures.bytes() + alpha_textures.bytes()) / (1024.0 * 1024.0));
+                    ImGui::Text("Levels streamed in: %lu, evicted: %lu", residency.streamed_in, residency.evicted);
+                    if (!textures.is_sparse() && !alpha_textures.is_sparse())
+                        ImGui::Text("ARB_sparse_texture not available, all levels resident");
+                    for (auto const& state : residency.states())
+                        ImGui::Text("%s layer %d: level %d (wanted %d, tail %d), used frame %llu", state.array == &textures ? "opaque" : "alpha",
+                            state.layer, state.array->resident_level(state.layer), state.wanted, state.array->tail_level(), state.last_used);
+                }
 
                 ImGui::Separator();
                 ImGui::Text("Kamera:");
-                ImGui::Image((ImTextureID)camera_texture, ImVec2(320, 240));
+                if (camera_texture.getID()) {
+                    ImGui::Image((ImTextureID)(intptr_t)camera_texture.getID(), ImVec2(320, 240));
+                    {
+                        // bounding boxes of present colour classes over the preview (CPU yellow, GPU cyan)
+                        const DetectionResult& result = detections.read_buffer();
+                        const ImVec2 origin = ImGui::GetItemRectMin();
+                        auto draw_boxes = [&](const ColorDetection& detection, const cv::Size frame_size, const ImU32 color) {
+                            if (frame_size.width <= 0 || frame_size.height <= 0)
+                                return;
+                            const float sx = 320.0f / frame_size.width, sy = 240.0f / frame_size.height;
+                            for (size_t c = 0; c < color_classifier.classes().size(); c++) {
+                                const cv::Rect box = detection.boxes[c].rect();
+                                if (box.empty() || detection.pixels[c] < color_min_pixels)
+                                    continue;
+                                const ImVec2 p0(origin.x + box.x * sx, origin.y + box.y * sy);
+                                ImGui::GetWindowDrawList()->AddRect(p0, ImVec2(origin.x + (box.x + box.width) * sx, origin.y + (box.y + box.height) * sy), color);
+                                ImGui::GetWindowDrawList()->AddText(p0, color, color_classifier.classes()[c].name.c_str());
+                            }
+                        };
+                        if (detection_backend != DetectionBackend::CPU)
+                            draw_boxes(gpu_detector.result().detection, gpu_detector.result().frame_size, IM_COL32(0, 255, 255, 255));
+                        if (detection_backend != DetectionBackend::GPU && result.frame_size.width > 0 && result.frame_size.height > 0) {
+                            draw_boxes(result.detection, result.frame_size, IM_COL32(255, 255, 0, 255));
+                            const float sx = 320.0f / result.frame_size.width, sy = 240.0f / result.frame_size.height;
+                            // tracked object (green) and its search window (grey)
+                            const ColorTrack& track = result.track;
+                            auto rect = [&](const cv::Rect& r, const ImU32 color) {
+                                ImGui::GetWindowDrawList()->AddRect(ImVec2(origin.x + r.x * sx, origin.y + r.y * sy),
+                                    ImVec2(origin.x + (r.x + r.width) * sx, origin.y + (r.y + r.height) * sy), color);
+                            };
+                            if (tracking_on && !track.full_scan && !track.window.empty())
+                                rect(track.window, IM_COL32(160, 160, 160, 255));
+                            if (track.found) {
+                                rect(track.box, IM_COL32(0, 255, 0, 255));
+                                ImGui::GetWindowDrawList()->AddCircleFilled(ImVec2(origin.x + track.centroid.x * sx, origin.y + track.centroid.y * sy),
+                                    3.0f, IM_COL32(0, 255, 0, 255));
+                            }
+                        }
+                    }
+                    ImGui::Text("Camera frames: %lu uploaded, %lu dropped (%s)", camera_texture.uploaded.load(), camera_texture.dropped.load(),
+                        camera_texture.format() == CameraTexture::Format::YUYV ? "YUYV, GPU conversion" : "BGR");
+                    ImGui::Text("Latency capture->upload  p50 %3.0f  p95 %3.0f  p99 %3.0f ms", capture_to_upload.percentile(50),
+                        capture_to_upload.percentile(95), capture_to_upload.percentile(99));
+                    ImGui::Text("Latency capture->present p50 %3.0f  p95 %3.0f  p99 %3.0f ms", capture_to_present.percentile(50),
+                        capture_to_present.percentile(95), capture_to_present.percentile(99));
+                    {
+                        // only bins up to the slowest sample in the window
+                        auto const& bins = capture_to_present.histogram();
+                        int used = int(bins.size());
+                        while (used > 1 && bins[used - 1] == 0.0f)
+                            used--;
+                        ImGui::PlotHistogram("##latency", bins.data(), used, 0, "capture->present [ms]", 0.0f, FLT_MAX, ImVec2(320, 60));
+                    }
+                    if (camera_texture.timestamp().device_ms >= 0.0)
+                        ImGui::Text("Device timestamp: %.1f ms", camera_texture.timestamp().device_ms);
+                    if (detection_backend != DetectionBackend::GPU) {
+                        using ms = std::chrono::duration<double, std::milli>;
+                        const DetectionResult& result = detections.read_buffer();
+                        ImGui::Text("Colour detection: frame %llu, %llu skipped, capture->result %.1f ms, age %.0f ms", result.sequence, detections.skipped(),
+                            ms(result.analyzed - result.timestamp.captured).count(), ms(std::chrono::steady_clock::now() - result.analyzed).count());
+                    }
+                    ImGui::Text("Frame pool: %d of %d blocks, %lu allocations (%lu heap), %lu after warm-up", frame_pool.blocks_in_use(), frame_pool.blocks(),
+                        frame_pool.allocations(), frame_pool.heap_allocations(), frame_pool.allocations_since_warm_up());
+                }
+
+                if (ImGui::CollapsingHeader("Colour detection")) {
+                    const char* backends[] = { "CPU (analyze stage)", "GPU (compute shader)", "CPU + GPU (compare)" };
+                    int backend = int(detection_backend.load());
+                    ImGui::BeginDisabled(!GpuColorDetector::supported());
+                    if (ImGui::Combo("Backend", &backend, backends, IM_ARRAYSIZE(backends)))
+                        detection_backend = DetectionBackend(backend);
+                    ImGui::EndDisabled();
+                    if (!GpuColorDetector::supported())
+                        ImGui::Text("Compute shaders not supported, CPU only");
+                    if (detection_backend != DetectionBackend::CPU) {
+                        using ms = std::chrono::duration<double, std::milli>;
+                        const GpuColorDetector::Result& gpu = gpu_detector.result();
+                        ImGui::Text("GPU: frame %llu, %.3f ms dispatch, read back after %d frame(s), capture->result %.1f ms, %lu skipped",
+                            gpu.frame, gpu_detector.gpu_ms(), gpu.latency_frames, ms(gpu.read - gpu.timestamp.captured).count(), gpu_detector.skipped);
+                    }
+                    ImGui::SliderInt("Min pixels", &color_min_pixels, 1, 10000, "%d", ImGuiSliderFlags_Logarithmic);
+                    int coarse_step = color_coarse_step;
+                    if (ImGui::SliderInt("Coarse step (0 = off)", &coarse_step, 0, 16))
+                        color_coarse_step = coarse_step;
+                    auto const& classes = color_classifier.classes();
+                    if (detection_backend == DetectionBackend::GPU) {
+                        // tiles, tracker and spotlight follow work on the CPU result, which is not produced now
+                        ImGui::TextDisabled("Tiles / tracking: CPU backend only");
+                    }
+                    else {
+                        if (tracking_on && !detections.read_buffer().track.full_scan)
+                            ImGui::Text("Tiles examined: none (window search)");
+                        else
+                            ImGui::Text("Tiles examined: %d of %d (%d px, %zu threads)", color_detector.tiles_examined.load(), color_detector.tiles_total.load(),
+                                color_detector.tile_size, detection_workers.size() + 1);
+
+                        bool tracking = tracking_on;
+                        if (ImGui::Checkbox("Track", &tracking))
+                            tracking_on = tracking;
+                        if (ImGui::IsItemHovered())
+                            ImGui::SetTooltip("Only a window around the tracked object is searched, counts of other classes cover just that window");
+                        ImGui::SameLine();
+                        int tracked = tracked_class;
+                        ImGui::SetNextItemWidth(120);
+                        if (ImGui::BeginCombo("##tracked", tracked < int(classes.size()) ? classes[tracked].name.c_str() : "")) {
+                            for (int c = 0; c < int(classes.size()); c++)
+                                if (ImGui::Selectable(classes[c].name.c_str(), c == tracked))
+                                    tracked_class = c;
+                            ImGui::EndCombo();
+                        }
+                        ImGui::SameLine();
+                        ImGui::Checkbox("Spotlight follows", &spotlight_follow);
+                        if (tracking) {
+                            const DetectionResult& result = detections.read_buffer();
+                            const ColorTrack& track = result.track;
+                            const double frame_pixels = std::max(1.0, double(result.frame_size.area()));
+                            if (track.found)
+                                ImGui::Text("Tracked: %d px at %.0f,%.0f (%s)", track.area, track.centroid.x, track.centroid.y,
+                                    track.full_scan ? "full scan" : "window");
+                            else
+                                ImGui::Text("Tracked: lost (full scan)");
+                            ImGui::Text("Examined: %.1f %% of frame", 100.0 * track.pixels_examined / frame_pixels);
+                        }
+                    }
+                    const DetectionBackend shown = detection_backend;
+                    const ColorDetection& detection = (shown == DetectionBackend::GPU) ? gpu_detector.result().detection : detections.read_buffer().detection;
+                    for (size_t c = 0; c < classes.size(); c++) {
+                        const int pixels = detection.pixels[c];
+                        const cv::Rect box = detection.boxes[c].rect();
+                        ImGui::Checkbox((classes[c].name + " (sound)").c_str(), &class_sound[c]);
+                        ImGui::SameLine(200);
+                        if (box.empty())
+                            ImGui::Text("%d px", pixels);
+                        else
+                            ImGui::Text("%d px in %dx%d at %d,%d%s", pixels, box.width, box.height, box.x, box.y, pixels >= color_min_pixels ? "  *" : "");
+                        if (shown == DetectionBackend::BOTH) {
+                            ImGui::SameLine();
+                            ImGui::Text("| GPU %d px", gpu_detector.result().detection.pixels[c]);
+                        }
+                    }
+                }
+
+                if (ImGui::CollapsingHeader("Camera pipeline")) {
+                    bool encode = encode_on;
+                    if (ImGui::Checkbox("Encode (JPEG quality search)", &encode))
+                        encode_on = encode;
+                    ImGui::SameLine();
+                    ImGui::Text("target PSNR %.0f dB (M/N)", target_quality.load());
+                    if (jpeg_bytes)
+                        ImGui::Text("JPEG: quality %d, %zu bytes", jpeg_quality.load(), jpeg_bytes.load());
+                    ImGui::Text("Frames in flight: %zu", camera_pipeline.frame_count());
+
+                    const auto stats = camera_pipeline.stats();
+                    for (size_t i = 0; i < stats.size(); i++) {
+                        auto const& s = stats[i];
+                        ImGui::PushID(int(i));
+                        ImGui::Text("%-8s %6.1f FPS %7.2f ms  queue %zu/%zu  drops %lu", s.name.c_str(), s.fps, s.busy_ms, s.queue_depth, s.queue_capacity, s.drops);
+                        if (i > 0) {    // first stage waits for free frames, no policy
+                            ImGui::SameLine();
+                            int policy = (s.policy == CameraPipeline::Policy::BLOCK) ? 0 : 1;
+                            ImGui::SetNextItemWidth(120);
+                            if (ImGui::Combo("##policy", &policy, "block\0drop oldest\0"))
+                                camera_pipeline.set_policy(i, policy == 0 ? CameraPipeline::Policy::BLOCK : CameraPipeline::Policy::DROP_OLDEST);
+                        }
+                        ImGui::PopID();
+                    }
+                }
 
 
                 ImGui::End();
@@ -732,20 +1021,26 @@ int App::run(void)
                 time_speed = 1.0;
             }
 
-            // Clear OpenGL canvas, both color buffer and Z-buffer
+            // Clear OpenGL canvas, both color buffer and Z-buffer (glClear respects depth mask)
+            gl_state.depthMask(true);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-            // 1. Aktivuj shader
-            shader.activate();
+            // 1. Features zapnuté pro celý snímek (material features přidá každý model)
+            unsigned frame_features = 0;
+            if (dirlight_on)
+                frame_features |= FEATURE_DIRLIGHT;
+            if (dirlight_on && specular_on)
+                frame_features |= FEATURE_SPECULAR;
+            // vypnutý reflektor = varianta bez reflektoru, ne nulová barva
+            if (spotlight_on && spotlight_intensity > 0.0f)
+                frame_features |= FEATURE_SPOTLIGHT;
+            frame_number++;
 
             // 2. Nastav barvu (už máš)
 
             // 3. Nastav transformační matice
-            float angle = (float)glfwGetTime(); // rotace v čase
-
-            glm::mat4 model_matrix = glm::rotate(glm::mat4(1.0f), glm::radians(-20.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-            model_matrix = glm::rotate(model_matrix, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            float angle = animation_time; // rotace v čase (zastavená animace = statická scéna, stíny se nepřekreslují)
 
             //ZMENA NA FREE
             glm::mat4 view_matrix = glm::lookAt(
@@ -765,86 +1060,264 @@ int App::run(void)
                 0.1f, 100.0f
             );
 
-            // 4. Pošli matice do shaderu
-            shader.setUniform("uM_m", model_matrix);
-            shader.setUniform("uV_m", view_matrix);
-            shader.setUniform("uP_m", projection_matrix);
-
-
-            // Ambient
-            shader.setUniform("ambientColor", glm::vec3(0.1f, 0.1f, 0.1f));
-
-            // Directional light
-            shader.setUniform("dirLightDirection", glm::vec3(-0.2f, -1.0f, -0.3f));
-            shader.setUniform("dirLightColor", glm::vec3(0.9f));
-
             // Kamera (pozice a směr)
             glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
             glm::vec3 cameraFront = glm::normalize(glm::vec3(0.0f, 0.0f, -1.0f)); // jednoduchá verze
 
-            // Spotlight
-            shader.setUniform("spotPos", cameraPos);
-            shader.setUniform("spotDir", cameraFront);
-
-            // Tady rozsvítíme nebo zhasneme reflektor
-            if (spotlight_on) {
-                shader.setUniform("spotColor", glm::vec3(1.0f) * spotlight_intensity);
+            // Spotlight míří na sledovaný objekt: poloha v obrazu kamery -> směr ve výhledu (stejné FOV),
+            // vyhlazeně; bez objektu se vrací doprostřed
+            glm::vec3 spotDir = cameraFront;
+            if (spotlight_follow) {
+                const DetectionResult& result = detections.read_buffer();
+                glm::vec2 target(0.0f);
+                if (tracking_on && detection_backend != DetectionBackend::GPU && result.track.found && result.frame_size.width > 0 && result.frame_size.height > 0)
+                    target = glm::vec2(2.0f * result.track.centroid.x / result.frame_size.width - 1.0f,
+                        1.0f - 2.0f * result.track.centroid.y / result.frame_size.height);
+                spot_target = glm::mix(spot_target, target, 0.2f);
+                if (glm::distance(spot_target, target) < 1e-3f)
+                    spot_target = target;   // settled -> light stops moving, spot shadow map stays cached
+
+                const glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+                const glm::vec3 up = glm::cross(right, cameraFront);
+                const float tan_half = std::tan(glm::radians(45.0f) * 0.5f);
+                spotDir = glm::normalize(cameraFront + right * (spot_target.x * tan_half * aspect) + up * (spot_target.y * tan_half));
             }
-            else {
-                shader.setUniform("spotColor", glm::vec3(0.0f));
+
+            // Bodová světla: spirála kolem scény, rozdělí se do clusterů a nahrají do SSBO
+            if (clustered_on && point_light_count > 0) {
+                light_clusters.lights.clear();
+                for (int i = 0; i < point_light_count; i++) {
+                    float a = i * 2.39996f + angle * 0.3f;     // zlatý úhel
+                    float r = 1.0f + 7.0f * std::sqrt((i + 0.5f) / point_light_count);
+                    glm::vec3 pos(r * std::cos(a), 1.5f * std::sin(angle + i), r * std::sin(a));
+                    glm::vec3 color = glm::abs(glm::vec3(std::sin(i * 0.7f), std::sin(i * 1.3f + 2.0f), std::sin(i * 2.1f + 4.0f)));
+                    light_clusters.lights.push_back(Light::point(pos, 1.5f, color * point_light_intensity));
+                }
+                light_clusters.update(view_matrix, glm::radians(45.0f), aspect, 0.1f, 100.0f);
+                light_clusters.bind();
+                frame_features |= FEATURE_CLUSTERED;
             }
 
+            // 4. Aktivuj variantu shaderu, per-frame uniformy se do varianty pošlou jen při prvním použití ve snímku
+            //    (uniformy vypnutých features ve variantě vůbec nejsou)
+            //    deferred lighting pass = fullscreen triangle, world position from depth instead of matrices
+            auto use_lighting = [&](unsigned features) -> ShaderProgram& {
+                ShaderVariants& variants = (features & FEATURE_DEFERRED) ? deferred_shaders : lighting_shaders;
+                ShaderProgram& shader = variants.get(features);
+                shader.activate();
+                if (!variants.first_use(features, frame_number))
+                    return shader;
+
+                if (features & FEATURE_DEFERRED) {
+                    shader.setUniform("uInvViewProj", glm::inverse(projection_matrix * view_matrix));
+                }
+                else {
+                    shader.setUniform("uV_m", view_matrix);
+                    shader.setUniform("uP_m", projection_matrix);
+                }
 
-            // Spotlight cutoff úhly
-            shader.setUniform("spotCutOff", glm::cos(glm::radians(12.5f)));
-            shader.setUniform("spotOuterCutOff", glm::cos(glm::radians(17.5f)));
+                if (features & (FEATURE_CLUSTERED | FEATURE_DEFERRED)) {
+                    shader.setUniform("uViewport", glm::vec2(width, height));
+                }
 
-            // Pro výpočet zrcadlení
-            shader.setUniform("viewPos", cameraPos);
+                // Ambient
+                shader.setUniform("ambientColor", glm::vec3(0.1f, 0.1f, 0.1f));
+
+                if (features & FEATURE_DIRLIGHT) {
+                    // Directional light
+                    shader.setUniform("dirLightDirection", dirLightDirection);
+                    shader.setUniform("dirLightColor", glm::vec3(0.9f));
+                    shader.setUniform("uDirLightSpace", dir_shadow.light_space());
+                }
+
+                if (features & FEATURE_SPOTLIGHT) {
+                    // Spotlight
+                    shader.setUniform("spotPos", cameraPos);
+                    shader.setUniform("spotDir", spotDir);
+                    shader.setUniform("spotColor", glm::vec3(1.0f) * spotlight_intensity);
+
+                    // Spotlight cutoff úhly
+                    shader.setUniform("spotCutOff", glm::cos(glm::radians(12.5f)));
+                    shader.setUniform("spotOuterCutOff", glm::cos(glm::radians(17.5f)));
+                    shader.setUniform("uSpotLightSpace", spot_shadow.light_space());
+                }
+
+                if (features & FEATURE_CLUSTERED) {
+                    shader.setUniform("uClusterGrid", light_clusters.grid());
+                    shader.setUniform("uClusterDepth", light_clusters.depth_range());
+                }
+
+                if (features & FEATURE_SPECULAR) {
+                    // Pro výpočet zrcadlení
+                    shader.setUniform("viewPos", cameraPos);
+                }
+                return shader;
+            };
 
             float deltaTime = 0.0f;  // Čas mezi snímky
             float currentFrame = glfwGetTime();
             deltaTime = currentFrame - lastTime;
             lastTime = currentFrame;
+            if (animate_on)
+                animation_time += deltaTime;
 
+            // Transformace neprůhledných objektů, sdílí je všechny průchody (stíny, pre-pass, G-buffer, ...)
+            std::vector<std::pair<std::string, glm::mat4>> model_matrices = {
+                { "cube", glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.0f, 0.0f)), angle, glm::vec3(0.0f, 1.0f, 0.0f)) },
+                { "sphere", glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)), angle * 1.5f, glm::vec3(1.0f, 0.0f, 0.0f)) },
+            };
 
-            for (auto& model : scene) {
-                if (model.first == "cube" || model.first == "sphere") {
-                    glm::mat4 model_matrix = glm::mat4(1.0f);
+            glm::mat4 glass_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
 
-                    if (model.first == "cube") {
-                        model_matrix = glm::translate(model_matrix, glm::vec3(-2.0f, 0.0f, 0.0f));
-                        model_matrix = glm::rotate(model_matrix, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-                    }
-                    else if (model.first == "sphere") {
-                        model_matrix = glm::translate(model_matrix, glm::vec3(2.0f, 0.0f, 0.0f));
-                        model_matrix = glm::rotate(model_matrix, angle * 1.5f, glm::vec3(1.0f, 0.0f, 0.0f));
+            // dekódované textury z worker vláken -> GPU, max. ~2 ms na snímek
+            if (textures.process_uploads(2.0) == 0)
+                alpha_textures.process_uploads(2.0);
+
+            // Rezidence textur: velikost objektů na obrazovce určí potřebné mip úrovně, zbytek drží LRU v rozpočtu
+            {
+                glm::vec3 eye = glm::vec3(glm::inverse(view_matrix)[3]);
+                float pixels_per_unit = height / (2.0f * glm::tan(glm::radians(45.0f) * 0.5f));   // ve vzdálenosti 1
+                auto touch_model = [&](Model& model, const glm::mat4& model_matrix) {
+                    glm::vec3 center = glm::vec3(model_matrix * glm::vec4(glm::vec3(model.bounds), 1.0f));
+                    float scale = glm::max(glm::length(glm::vec3(model_matrix[0])), glm::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2]))));
+                    float radius = model.bounds.w * scale;
+                    glm::vec3 to_center = center - eye;
+                    if (glm::dot(to_center, glm::vec3(view_matrix[0][2], view_matrix[1][2], view_matrix[2][2])) > radius)
+                        return;     // celý za kamerou
+                    float pixels = 2.0f * radius * pixels_per_unit / glm::max(glm::length(to_center), 0.1f);
+                    for (auto const& mesh : model.meshes)
+                        if (mesh.texture_array && mesh.texture_layer >= 0)
+                            residency.touch(*mesh.texture_array, mesh.texture_layer, pixels, frame_number);
+                };
+                for (auto const& [name, model_matrix] : model_matrices)
+                    touch_model(scene[name], model_matrix);
+                touch_model(scene["cubealfa"], glass_matrix);
+
+                residency.budget = size_t(texture_budget_mb) * 1024 * 1024;
+                residency.update(frame_number, 1.0);
+            }
+
+            scene_timer.begin();
+
+            // Stíny: shadow mapa se překreslí jen když se pohne světlo nebo objekt v jeho dosahu
+            {
+                std::vector<ShadowCaster> casters;
+                for (auto const& [name, model_matrix] : model_matrices)
+                    casters.push_back({ &scene[name], model_matrix, animate_on });
+
+                ShaderProgram& depth_program = shadow_shaders.get(0);
+                if (frame_features & FEATURE_DIRLIGHT) {
+                    // ortho projekce kolem scény, světlo míří do středu
+                    glm::vec3 dir = glm::normalize(dirLightDirection);
+                    glm::mat4 light_view = glm::lookAt(-dir * 20.0f, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                    dir_shadow.update(light_view, glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 50.0f), casters, depth_program);
+                    gl_state.bindTexture(7, GL_TEXTURE_2D, dir_shadow.getID());
+                }
+                if (frame_features & FEATURE_SPOTLIGHT) {
+                    glm::mat4 light_view = glm::lookAt(cameraPos, cameraPos + spotDir, glm::vec3(0.0f, 1.0f, 0.0f));
+                    spot_shadow.update(light_view, glm::perspective(glm::radians(2.0f * 17.5f + 5.0f), 1.0f, 0.1f, 50.0f), casters, depth_program);
+                    gl_state.bindTexture(8, GL_TEXTURE_2D, spot_shadow.getID());
+                }
+            }
+
+            // program jen s maticemi (depth pre-pass, G-buffer), ostatní uniformy nastaví Mesh::draw
+            auto use_geometry = [&](ShaderVariants& variants, unsigned features) -> ShaderProgram& {
+                ShaderProgram& shader = variants.get(features);
+                shader.activate();
+                if (variants.first_use(features, frame_number)) {
+                    shader.setUniform("uV_m", view_matrix);
+                    shader.setUniform("uP_m", projection_matrix);
+                }
+                return shader;
+            };
+
+            // Neprůhledné objekty, use_program(material features) aktivuje program daného průchodu
+            // material = false: jen hloubka (bez textur, normál a materiálových uniforem)
+            auto draw_opaque = [&](auto&& use_program, bool material) {
+                for (auto const& [name, model_matrix] : model_matrices) {
+                    if (batching_on) {
+                        for (unsigned instance : batch_instances[name])
+                            opaque_batch.set_transform(instance, model_matrix);
+                        continue;
                     }
 
+                    Model& model = scene[name];
+                    ShaderProgram& shader = use_program(model.features());
                     shader.setUniform("uM_m", model_matrix);
-                    model.second.draw();
+                    if (material) {
+                        shader.setUniform("uN_m", normal_matrix(model_matrix));
+                        model.draw(shader);
+                    }
+                    else {
+                        model.draw_geometry();
+                    }
+                }
+
+                if (batching_on) {
+                    // všechny neprůhledné objekty jedním voláním, textury = vrstvy jednoho texture array
+                    use_program(FEATURE_TEXTURE | FEATURE_INSTANCED);
+                    if (material)
+                        textures.bind();
+                    opaque_batch.draw();
                 }
+            };
+
+            auto use_forward = [&](unsigned features) -> ShaderProgram& { return use_lighting(frame_features | features); };
+
+            gl_state.enable(GL_BLEND, false);
+            gl_state.enable(GL_CULL_FACE, true);
+
+            if (render_path == PATH_DEFERRED) {
+                // 1. G-buffer: albedo, normála, hloubka
+                gbuffer.resize(width, height);
+                gl_state.depthMask(true);
+                gbuffer.bind();
+                draw_opaque([&](unsigned features) -> ShaderProgram& { return use_geometry(gbuffer_shaders, features); }, true);
+
+                // 2. osvětlení jednou na pixel (fullscreen), pozadí zůstane z glClear
+                gl_state.bindFramebuffer(0);
+                gl_state.enable(GL_DEPTH_TEST, false);
+                use_lighting(frame_features | FEATURE_DEFERRED);
+                gbuffer.bind_textures();
+                gbuffer.draw_fullscreen();
+                gl_state.enable(GL_DEPTH_TEST, true);
+
+                // 3. hloubka pro průhledné objekty (dopředné vykreslení)
+                gbuffer.blit_depth(0);
+            }
+            else if (render_path == PATH_DEPTH_PREPASS) {
+                // 1. jen hloubka, 2. stínování pouze viditelných fragmentů (GL_EQUAL, bez zápisu hloubky)
+                gl_state.depthMask(true);
+                gl_state.colorMask(false);
+                draw_opaque([&](unsigned features) -> ShaderProgram& { return use_geometry(depth_shaders, features); }, false);
+                gl_state.colorMask(true);
+
+                gl_state.depthMask(false);
+                gl_state.depthFunc(GL_EQUAL);
+                draw_opaque(use_forward, true);
+                gl_state.depthFunc(GL_LESS);
+            }
+            else {
+                gl_state.depthMask(true);
+                draw_opaque(use_forward, true);
             }
 
             // Průhledné objekty nakonec
             {
-                glEnable(GL_BLEND);
-                glDepthMask(GL_FALSE);
-                glDisable(GL_CULL_FACE);
+                gl_state.enable(GL_BLEND, true);
+                gl_state.depthMask(false);
+                gl_state.enable(GL_CULL_FACE, false);
 
-                glm::mat4 model_matrix = glm::mat4(1.0f);
-                model_matrix = glm::translate(model_matrix, glm::vec3(0.0f, 0.0f, 0.0f)); // např. žádný posun
-                model_matrix = glm::scale(model_matrix, glm::vec3(2.0f)); 
+                glm::mat4 model_matrix = glass_matrix;
 
+                Model& glass = scene["cubealfa"];
+                ShaderProgram& shader = use_lighting(frame_features | glass.features());
                 shader.setUniform("uM_m", model_matrix);
-                scene["cubealfa"].draw();
-
-                glDisable(GL_BLEND);
-                glDepthMask(GL_TRUE);
-                glEnable(GL_CULL_FACE);
+                shader.setUniform("uN_m", normal_matrix(model_matrix));
+                glass.draw(shader);
             }
 
-
+            scene_timer.end();
 
 
             // ImGui display
@@ -858,26 +1331,44 @@ int App::run(void)
             // SWAP + VSYNC
             //
             glfwSwapBuffers(window);
+            gl_state.end_frame();
+
+            // snímek kamery nahraný minulý frame je právě prezentován
+            if (camera_frame_pending) {
+                log_camera_latency();
+                camera_frame_pending = false;
+            }
 
             //
             // POLL
             //
             glfwPollEvents();
 
-            std::lock_guard<std::mutex> lock(mux);
-            if (!frame.empty()) {
-                cv::Mat frameRGB;
-                cv::cvtColor(frame, frameRGB, cv::COLOR_BGR2RGB);
-
-                glBindTexture(GL_TEXTURE_2D, camera_texture);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frameRGB.cols, frameRGB.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, frameRGB.data);
-                glBindTexture(GL_TEXTURE_2D, 0);
+            // nejnovější snímek kamery z PBO do textury (kopii do PBO udělalo capture vlákno)
+            const bool camera_uploaded = camera_texture.update();
+            camera_frame_pending |= camera_uploaded;
+
+            // detekce na GPU přímo z nahrané textury, výsledek se přečte až po fence (obvykle příští snímek)
+            const DetectionBackend backend = detection_backend;
+            if (camera_uploaded && backend != DetectionBackend::CPU)
+                gpu_detector.detect(camera_texture, color_classifier);
+            const bool gpu_result = gpu_detector.update();
+
+            // výsledek detekce z pipeline (bez zámku, jen nejnovější)
+            const bool cpu_result = detections.update();
+            if (backend == DetectionBackend::GPU ? gpu_result : cpu_result) {
+                const ColorDetection& detection = (backend == DetectionBackend::GPU) ? gpu_detector.result().detection : detections.read_buffer().detection;
+                // zvuk hraje, je-li v obraze některá třída barev, která ho má zapnutý
+                bool sound = false;
+                for (size_t c = 0; c < color_classifier.classes().size(); c++)
+                    sound |= class_sound[c] && detection.pixels[c] >= color_min_pixels;
+                if (sound)
+                    play_audio();
+                else
+                    stop_audio();
             }
 
-            if (!frame.empty())
-                play_if_color();
-
-            target_quality = std::clamp(target_quality, 0.0f, 100.0f);
+            target_quality = std::clamp(target_quality.load(), 0.0f, 100.0f);
 
             now = glfwGetTime();
             previous_frame_render_time = now - frame_begin_timepoint; //compute delta_t
@@ -901,12 +1392,42 @@ int App::run(void)
     return EXIT_SUCCESS;
 }
 
+void App::log_camera_latency(void)
+{
+    // present = swap returned (with vsync the frame is queued for the next refresh)
+    using ms = std::chrono::duration<double, std::milli>;
+    const auto now = std::chrono::steady_clock::now();
+    const FrameTimestamp& timestamp = camera_texture.timestamp();
+    if (timestamp.captured.time_since_epoch().count() == 0)
+        return;
+
+    const double upload = ms(camera_texture.upload_time() - timestamp.captured).count();
+    const double present = ms(now - timestamp.captured).count();
+    capture_to_upload.add(upload);
+    capture_to_present.add(present);
+
+    if (latency_log)
+        latency_log << camera_texture.uploaded << ',' << ms(timestamp.captured - latency_epoch).count() << ',' << timestamp.device_ms << ','
+            << upload << ',' << present << '\n';
+}
+
 void App::destroy(void)
 {
-    // clean up ImGUI
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    // capture stage writes into mapped PBO -> stop it while GL context still exists
+    camera_pipeline.stop();
+    if (window) {
+        camera_texture.clear();
+        gpu_detector.clear();
+    }
+
+    // clean up ImGUI (only what init_imgui() got to, e.g. nothing with --benchmark-color)
+    if (ImGui::GetCurrentContext()) {
+        if (ImGui::GetIO().BackendRendererUserData)
+            ImGui_ImplOpenGL3_Shutdown();
+        if (ImGui::GetIO().BackendPlatformUserData)
+            ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
     // clean up OpenCV
     cv::destroyAllWindows();
@@ -918,12 +1439,6 @@ void App::destroy(void)
     }
     glfwTerminate();
     destroy_audio();
-
-    camera_running = false;
-    if (camera_thread.joinable()) {
-        camera_thread.join();
-    }
-
 }
 
 App::~App()
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include <vector>
+#include <chrono>
+#include <fstream>
 #include <opencv2/opencv.hpp>
 
 #include <GL/glew.h>
@@ -9,7 +11,25 @@
 
 #include "assets.hpp"
 #include "ShaderProgram.hpp"
+#include "ShaderVariants.hpp"
 #include "Model.h"
+#include "TextureArray.hpp"
+#include "TextureResidency.hpp"
+#include "CameraTexture.hpp"
+#include "TripleBuffer.hpp"
+#include "FramePool.hpp"
+#include "FrameSource.hpp"
+#include "CameraPipeline.hpp"
+#include "MeshBatch.hpp"
+#include "LightClusters.hpp"
+#include "GBuffer.hpp"
+#include "ShadowMap.hpp"
+#include "ThreadPool.hpp"
+#include "GpuTimer.h"
+#include "LatencyHistogram.h"
+#include "ColorDetect.hpp"
+#include "ColorTracker.hpp"
+#include "GpuColorDetect.hpp"
 #include "miniaudio.h"
 
 
@@ -20,8 +40,13 @@ public:
     App();
 
     ma_engine audio_engine; 
+    bool audio_is_init = false;     // audio_engine initialized (destroy() also runs when init() was never called)
 
-    GLuint camera_texture = 0;
+    FramePool frame_pool;           // camera frame buffers, must outlive all Mats below that use it
+    CameraTexture camera_texture;   // written by capture stage, uploaded by run()
+    CameraPipeline camera_pipeline; // capture -> convert -> analyze -> encode -> sinks, see init_camera_pipeline()
+    TripleBuffer<DetectionResult> detections;   // analyze stage -> run(), latest result only
+    GpuColorDetector gpu_detector;  // classifies camera_texture after upload, run() only
  
     float lastTime = 0.0f;  
 
@@ -31,21 +56,44 @@ public:
     void stop_audio();
     void destroy_audio();
 
-    bool init(void);
+    bool init(int argc = 0, char* argv[] = nullptr);   // command line selects frame source, see FrameSource.hpp
     void init_imgui();
     int run(void);
     void destroy(void);
-    void camera_loop();
+    void init_camera_pipeline();
 
     //CAMERA
-    std::thread camera_thread;
-    bool camera_running = true;
+    std::atomic<bool> encode_on{ false };   // lossy JPEG quality search in encode stage
+    std::atomic<size_t> jpeg_bytes{ 0 };    // last encoded frame (sinks stage)
+    std::atomic<int> jpeg_quality{ 0 };
+    ColorClassifier color_classifier;       // resources/color_classes.txt, set before the pipeline starts
+    int color_min_pixels = 1;               // class is present from this many pixels
+    std::atomic<int> color_coarse_step{ 8 };    // coarse-to-fine detection sample step, 0 = every tile at full resolution
+    std::array<bool, ColorClassifier::MAX_CLASSES> class_sound{ true };  // present class plays sound (first one by default)
+    enum class DetectionBackend { CPU, GPU, BOTH };    // BOTH: CPU result drives sound / tracking, GPU one is shown next to it
+    std::atomic<DetectionBackend> detection_backend{ DetectionBackend::CPU };
+    // analyze stage follows one class (window search) instead of full-frame detection; off by default,
+    // counts (and so sounds) of the other classes only cover the search window while it is on
+    std::atomic<bool> tracking_on{ false };
+    std::atomic<int> tracked_class{ 0 };
+    ColorTracker color_tracker;                 // analyze stage only
+    bool spotlight_follow = true;               // spotlight aims at tracked object
+    glm::vec2 spot_target{ 0.0f };              // smoothed tracked position, NDC of camera image (0,0 = straight ahead)
+    unsigned long long captured_frames = 0; // capture stage only
+    bool camera_yuyv = true;        // request raw YUYV, colour conversion on GPU (falls back to BGR)
+
+    // camera latency, render thread: texture uploaded in one frame is presented by the swap of the next one
+    LatencyHistogram capture_to_upload, capture_to_present;
+    bool camera_frame_pending = false;      // uploaded, not presented yet
+    std::string latency_log_path;           // --latency-log FILE, empty = no CSV
+    std::ofstream latency_log;              // CSV, one line per presented camera frame
+    std::chrono::steady_clock::time_point latency_epoch;
+    void log_camera_latency(void);
 
     ~App();
 private:
-    cv::VideoCapture capture;
+    std::unique_ptr<FrameSource> source;    // camera, video, images or synthetic
 
-    cv::Mat scene_hsv, scene_threshold;
 
     // GL
     GLFWwindow* window = nullptr;
@@ -61,6 +109,27 @@ private:
     bool spotlight_on = true;
     float spotlight_intensity = 1.0f;
 
+    //DIRECTIONAL LIGHT (vypnuté světlo = varianta shaderu bez něj)
+    bool dirlight_on = true;
+    bool specular_on = true;
+    glm::vec3 dirLightDirection = glm::vec3(-0.2f, -1.0f, -0.3f);
+
+    //ANIMACE (zastavená = statická scéna, cachované stíny nic nestojí)
+    bool animate_on = true;
+    float animation_time = 0.0f;
+
+    //BATCHING (neprůhledné objekty jedním multi-draw voláním)
+    bool batching_on = true;
+
+    //RENDER PATH (porovnání overdraw: GPU čas scény v ImGui)
+    enum RenderPath : int { PATH_FORWARD = 0, PATH_DEPTH_PREPASS, PATH_DEFERRED };
+    int render_path = PATH_FORWARD;
+
+    //CLUSTERED LIGHTS (bodová světla kolem scény)
+    bool clustered_on = true;
+    int point_light_count = 256;
+    float point_light_intensity = 0.3f;
+
     //FULLSCREEN
     bool is_fullscreen = false;
     int windowed_pos_x = 100, windowed_pos_y = 100;
@@ -88,7 +157,6 @@ private:
     void init_glfw(void);
     void init_gl_debug();
     void init_assets(void);
-    void start_capture_thread();
 
     void print_opencv_info();
     void print_glfw_info(void);
@@ -105,7 +173,6 @@ private:
     static void glfw_scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
     static void GLAPIENTRY MessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
     
-    void play_if_color();
 
     //new GL stuff
     GLuint shader_prog_ID{ 0 };
@@ -121,7 +188,27 @@ private:
         {{-0.5f, -0.5f,  0.0f}}
     };
 
-    ShaderProgram shader;
+    ShaderVariants lighting_shaders;            // lighting.vert/.frag, all feature permutations
+    ShaderVariants depth_shaders;               // lighting.vert + depth.frag (depth pre-pass)
+    ShaderVariants gbuffer_shaders;             // lighting.vert + gbuffer.frag (deferred, geometry pass)
+    ShaderVariants deferred_shaders;            // deferred.vert + lighting.frag (deferred, lighting pass)
+    ShaderVariants shadow_shaders;              // lighting.vert + depth.frag, non-instanced (shadow maps, own light matrices)
+    GBuffer gbuffer;
+    ShadowMap dir_shadow{ 2048 };               // directional light, static + dynamic caster layers
+    ShadowMap spot_shadow{ 2048 };              // spotlight
+    unsigned long long frame_number = 0;
+    GpuTimer scene_timer;                       // GPU time of scene draw (without ImGui)
+    ThreadPool workers;                         // background jobs (texture decoding, light clusters), must outlive users below
+    // colour detection tiles get their own threads, so analyze never queues behind texture decoding / BC encoding
+    ThreadPool detection_workers{ std::max(1u, ThreadPool::default_threads() / 2) };
+    TiledColorDetector color_detector{ detection_workers };     // analyze stage only
+    TextureArray textures{ 2048, &workers, TextureFormat::BC1 };        // opaque diffuse textures, one layer each
+    TextureArray alpha_textures{ 2048, &workers, TextureFormat::BC3 };  // textures with alpha (transparent pass)
+    TextureResidency residency{ 32 * 1024 * 1024 };                     // GPU memory budget of both arrays above
+    int texture_budget_mb = 32;
+    MeshBatch opaque_batch;                     // opaque models, instanced + multi-draw indirect
+    LightClusters light_clusters{ 16, 9, 24, &workers };   // point lights assigned to view frustum clusters
+    std::unordered_map<std::string, std::vector<unsigned>> batch_instances;  // scene name -> instances in opaque_batch (one per mesh)
     std::unordered_map<std::string, Model> scene;
 };
 
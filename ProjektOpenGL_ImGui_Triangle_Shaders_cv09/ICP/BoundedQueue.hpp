@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Fixed capacity FIFO between two pipeline stages (one producer thread, one consumer thread).
+// Storage is allocated once; push/pop only move elements.
+// When full, push() either waits for the consumer (BLOCK, backpressure up the pipeline)
+// or replaces the oldest element (DROP_OLDEST, which is returned so the caller can recycle it).
+// Policy can be switched while running. close() wakes both sides, after it push() refuses and pop() drains what is left.
+template <typename T>
+class BoundedQueue {
+public:
+    enum class Policy { BLOCK, DROP_OLDEST };
+
+    explicit BoundedQueue(const size_t capacity, const Policy policy = Policy::BLOCK)
+        : ring(capacity), policy(policy) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // returns dropped element (DROP_OLDEST when full) or the value itself if the queue is closed
+    std::optional<T> push(T value) {
+        std::optional<T> dropped;
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            not_full.wait(lock, [&] { return count < ring.size() || closed || policy == Policy::DROP_OLDEST; });
+            if (closed)
+                return value;
+            if (count == ring.size()) {
+                dropped = std::move(ring[head]);
+                head = (head + 1) % ring.size();
+                count--;
+                drops++;
+            }
+            ring[(head + count) % ring.size()] = std::move(value);
+            count++;
+            depth = count;
+        }
+        not_empty.notify_one();
+        return dropped;
+    }
+
+    // waits for an element, empty optional = closed and drained
+    std::optional<T> pop(void) {
+        std::optional<T> value;
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            not_empty.wait(lock, [&] { return count > 0 || closed; });
+            if (count == 0)
+                return value;
+            value = std::move(ring[head]);
+            head = (head + 1) % ring.size();
+            count--;
+            depth = count;
+        }
+        not_full.notify_one();
+        return value;
+    }
+
+    void set_policy(const Policy p) {
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            policy = p;
+        }
+        not_full.notify_all();
+    }
+
+    void close(void) {
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    // readable from any thread (statistics)
+    size_t capacity(void) const { return ring.size(); }
+    size_t size(void) const { return depth; }
+    unsigned long dropped(void) const { return drops; }
+    Policy get_policy(void) const { return policy; }
+
+private:
+    std::vector<T> ring;
+    size_t head = 0, count = 0;
+    bool closed = false;
+
+    std::mutex mux;
+    std::condition_variable not_empty, not_full;
+
+    std::atomic<size_t> depth{ 0 };
+    std::atomic<unsigned long> drops{ 0 };
+    std::atomic<Policy> policy;     // written under mux
+};
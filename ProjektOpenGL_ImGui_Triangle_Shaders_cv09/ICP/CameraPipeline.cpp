@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "CameraPipeline.hpp"
+
+void CameraPipeline::add_stage(const std::string& name, StageFunction function, const size_t input_capacity, const Policy policy)
+{
+    if (running())
+        throw std::runtime_error("CameraPipeline: stage added while running");
+    stages.push_back(std::make_unique<Stage>(name, std::move(function), std::max<size_t>(1, input_capacity), policy));
+}
+
+void CameraPipeline::start(const std::function<void(CameraFrame&)>& init_frame)
+{
+    if (running() || stages.empty())
+        return;
+
+    const size_t count = frames_needed();
+    free_frames = std::make_unique<BoundedQueue<CameraFrame*>>(count);
+    frames.clear();
+    for (size_t i = 0; i < count; i++) {
+        frames.push_back(std::make_unique<CameraFrame>());
+        if (init_frame)
+            init_frame(*frames.back());
+        free_frames->push(frames.back().get());
+    }
+
+    stopping = false;
+    last_stats = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < stages.size(); i++)
+        threads.emplace_back(&CameraPipeline::stage_loop, this, i);
+}
+
+size_t CameraPipeline::frames_needed(void) const
+{
+    // + 1 so that the first stage does not wait while the last one recycles
+    size_t count = stages.size() + 1;
+    for (size_t i = 1; i < stages.size(); i++)
+        count += stages[i]->input.capacity();
+    return count;
+}
+
+void CameraPipeline::stop(void)
+{
+    if (!running())
+        return;
+
+    stopping = true;
+    free_frames->close();
+    for (auto& stage : stages)
+        stage->input.close();
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+void CameraPipeline::recycle(CameraFrame* frame)
+{
+    free_frames->push(frame);      // never full (holds all frames), refused only when stopping
+}
+
+void CameraPipeline::stage_loop(const size_t index)
+{
+    Stage& stage = *stages[index];
+    while (true) {
+        std::optional<CameraFrame*> frame = (index == 0) ? free_frames->pop() : stage.input.pop();
+        if (!frame || stopping)
+            break;      // stopped (frames left in queues are not processed any more)
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool keep = stage.function(**frame);
+        stage.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        stage.processed++;
+
+        if (!keep || index + 1 == stages.size()) {
+            recycle(*frame);
+        }
+        else {
+            // dropped oldest (or refused when stopping) goes back to free frames
+            std::optional<CameraFrame*> back = stages[index + 1]->input.push(*frame);
+            if (back)
+                recycle(*back);
+        }
+    }
+}
+
+std::vector<CameraPipeline::StageStats> CameraPipeline::stats(void)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - last_stats).count();
+    const bool update = elapsed >= 1.0;
+    if (update)
+        last_stats = now;
+
+    std::vector<StageStats> result;
+    for (size_t i = 0; i < stages.size(); i++) {
+        Stage& stage = *stages[i];
+        if (update) {
+            const unsigned long processed = stage.processed;
+            const long long busy = stage.busy_ns;
+            const unsigned long frames_now = processed - stage.last_processed;
+            stage.fps = frames_now / elapsed;
+            stage.busy_ms = frames_now ? (busy - stage.last_busy_ns) * 1e-6 / frames_now : 0.0;
+            stage.last_processed = processed;
+            stage.last_busy_ns = busy;
+        }
+        const BoundedQueue<CameraFrame*>& input = (i == 0 && free_frames) ? *free_frames : stage.input;
+        result.push_back({ stage.name, stage.processed, stage.fps, stage.busy_ms,
+            input.size(), input.capacity(), stage.input.dropped(), input.get_policy() });
+    }
+    return result;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "BoundedQueue.hpp"
+#include "FrameSource.hpp"
+#include "ColorDetect.hpp"
+#include "ColorTracker.hpp"
+
+// one camera frame travelling through CameraPipeline, recycled (buffers keep their allocation)
+struct CameraFrame {
+    unsigned long long sequence = 0;
+    FrameTimestamp timestamp;
+    cv::Mat image;                  // as delivered by frame source (BGR or raw YUYV)
+    bool yuyv = false;
+    cv::Size size;                  // in pixels, set by capture (raw YUYV buffer does not know it)
+    cv::Mat bgr;                    // BGR image (shares image if it already is BGR)
+    bool bgr_ready = false;         // bgr holds this frame (convert skips YUYV conversion nobody would use)
+    std::vector<uchar> jpeg;        // lossy encoded frame (empty = encoding off)
+    int jpeg_quality = 0;
+};
+
+// colour detection of one frame, published by the analyze stage for the render thread
+struct DetectionResult {
+    unsigned long long sequence = 0;
+    FrameTimestamp timestamp;                           // of the analyzed frame
+    std::chrono::steady_clock::time_point analyzed{};   // result ready
+    cv::Size frame_size;
+    ColorDetection detection;   // pixels and bounding box of each colour class (tracking: searched window only)
+    ColorTrack track;           // tracked object (found = false when tracking is off)
+};
+
+// Linear chain of stages, each on its own thread, e.g. capture -> convert -> analyze -> encode -> sinks.
+// Stages are connected by bounded queues (BoundedQueue) of frame pointers; frames come from a fixed set
+// allocated by start() and return to it after the last stage or when dropped, so frames are never allocated
+// while running. First stage receives a free frame to fill (waits while all frames are in use).
+// Stage function returns false to drop the frame (e.g. source failed).
+// stop() does not drain queues: frames still waiting are abandoned (no more device reads, encodes, ...).
+class CameraPipeline {
+public:
+    using Policy = BoundedQueue<CameraFrame*>::Policy;
+    using StageFunction = std::function<bool(CameraFrame&)>;
+
+    struct StageStats {
+        std::string name;
+        unsigned long frames;       // processed, since start
+        double fps;                 // over last second
+        double busy_ms;             // average time in stage function per frame, over last second
+        size_t queue_depth, queue_capacity;     // input queue (first stage: free frames)
+        unsigned long drops;        // frames dropped from input queue (DROP_OLDEST)
+        Policy policy;
+    };
+
+    CameraPipeline(void) = default;
+    ~CameraPipeline() { stop(); }
+
+    CameraPipeline(const CameraPipeline&) = delete;
+    CameraPipeline& operator=(const CameraPipeline&) = delete;
+
+    // before start(); input queue of the first stage is not used
+    void add_stage(const std::string& name, StageFunction function, const size_t input_capacity = 2, const Policy policy = Policy::DROP_OLDEST);
+
+    // allocate frames (init_frame is called for each one, before any thread starts) and start stage threads
+    void start(const std::function<void(CameraFrame&)>& init_frame = {});
+    void stop(void);                // close queues, join threads
+    bool running(void) const { return !threads.empty(); }
+
+    size_t frames_needed(void) const;       // every stage working on one frame and every queue full
+    size_t frame_count(void) const { return frames.size(); }
+    size_t stage_count(void) const { return stages.size(); }
+    void set_policy(const size_t stage, const Policy policy) { stages.at(stage)->input.set_policy(policy); }
+
+    // render thread (keeps per-second rates between calls)
+    std::vector<StageStats> stats(void);
+
+private:
+    struct Stage {
+        Stage(const std::string& name, StageFunction function, const size_t capacity, const Policy policy)
+            : name(name), function(std::move(function)), input(capacity, policy) {}
+        std::string name;
+        StageFunction function;
+        BoundedQueue<CameraFrame*> input;
+        std::atomic<unsigned long> processed{ 0 };
+        std::atomic<long long> busy_ns{ 0 };
+
+        // stats() only
+        unsigned long last_processed = 0;
+        long long last_busy_ns = 0;
+        double fps = 0.0, busy_ms = 0.0;
+    };
+
+    void stage_loop(const size_t index);
+    void recycle(CameraFrame* frame);
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::vector<std::unique_ptr<CameraFrame>> frames;
+    std::unique_ptr<BoundedQueue<CameraFrame*>> free_frames;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping{ false };
+    std::chrono::steady_clock::time_point last_stats{};
+};
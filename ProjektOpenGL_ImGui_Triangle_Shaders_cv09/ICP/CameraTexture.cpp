@@ -0,0 +1,215 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "CameraTexture.hpp"
+#include "GLState.hpp"
+
+bool CameraTexture::write(const unsigned char* data, const int width, const int height, const size_t step, const Format format,
+    const FrameTimestamp& timestamp)
+{
+    int index = -1;
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        if (width != requested_width || height != requested_height || format != requested_format) {
+            // new resolution, render thread re-creates texture + buffers
+            requested_width = width;
+            requested_height = height;
+            requested_format = format;
+            dropped++;
+            return false;
+        }
+        if (width != tex_width || height != tex_height || format != tex_format || pbo_data == nullptr) {
+            dropped++;
+            return false;   // not re-created yet
+        }
+
+        // free slot, otherwise the oldest written one (never uploaded, replaced by this frame)
+        for (int i = 0; i < SLOTS; i++)
+            if (slot[i] == Slot::FREE) {
+                index = i;
+                break;
+            }
+        if (index < 0) {
+            for (int i = 0; i < SLOTS; i++)
+                if (slot[i] == Slot::WRITTEN && (index < 0 || slot_sequence[i] < slot_sequence[index]))
+                    index = i;
+            if (index < 0) {
+                dropped++;
+                return false;
+            }
+            dropped++;
+        }
+        slot[index] = Slot::WRITING;
+    }
+
+    // copy outside of lock, rows tightly packed (GL_UNPACK_ALIGNMENT 1)
+    unsigned char* dst = pbo_data + slot_size * index;
+    const size_t row = row_bytes();
+    if (step == row) {
+        std::memcpy(dst, data, row * height);
+    }
+    else {
+        for (int y = 0; y < height; y++)
+            std::memcpy(dst + row * y, data + step * y, row);
+    }
+
+    std::lock_guard<std::mutex> lock(mux);
+    slot[index] = Slot::WRITTEN;
+    slot_sequence[index] = ++sequence;
+    slot_timestamp[index] = timestamp;
+    return true;
+}
+
+bool CameraTexture::update(void)
+{
+    int newest = -1;
+    {
+        std::lock_guard<std::mutex> lock(mux);
+
+        // slots read by GPU already -> free
+        for (int i = 0; i < SLOTS; i++) {
+            if (slot[i] == Slot::IN_FLIGHT && glClientWaitSync(slot_fence[i], 0, 0) != GL_TIMEOUT_EXPIRED) {
+                glDeleteSync(slot_fence[i]);
+                slot_fence[i] = nullptr;
+                slot[i] = Slot::FREE;
+            }
+        }
+
+        if (requested_width != tex_width || requested_height != tex_height || requested_format != tex_format) {
+            bool writing = false;
+            for (int i = 0; i < SLOTS; i++)
+                writing |= (slot[i] == Slot::WRITING);
+            if (!writing)
+                reallocate();
+            return false;
+        }
+
+        // newest written frame, older ones are dropped
+        for (int i = 0; i < SLOTS; i++)
+            if (slot[i] == Slot::WRITTEN && (newest < 0 || slot_sequence[i] > slot_sequence[newest]))
+                newest = i;
+        for (int i = 0; i < SLOTS; i++)
+            if (slot[i] == Slot::WRITTEN && i != newest) {
+                slot[i] = Slot::FREE;
+                dropped++;
+            }
+        if (newest < 0)
+            return false;
+        slot[newest] = Slot::IN_FLIGHT;     // capture thread does not touch it any more
+        tex_timestamp = slot_timestamp[newest];
+    }
+
+    gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+    const void* offset = reinterpret_cast<const void*>(slot_size * newest);
+    if (tex_format == Format::YUYV)
+        glTextureSubImage2D(source, 0, 0, 0, tex_width / 2, tex_height, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+    else
+        glTextureSubImage2D(ID, 0, 0, 0, tex_width, tex_height, GL_BGR, GL_UNSIGNED_BYTE, offset);
+    gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    slot_fence[newest] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (tex_format == Format::YUYV)
+        convert_yuyv();
+    tex_upload = std::chrono::steady_clock::now();
+    uploaded++;
+    return true;
+}
+
+void CameraTexture::convert_yuyv(void)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const bool depth_test = glIsEnabled(GL_DEPTH_TEST), blend = glIsEnabled(GL_BLEND);
+
+    gl_state.bindFramebuffer(FBO);
+    glViewport(0, 0, tex_width, tex_height);
+    gl_state.enable(GL_DEPTH_TEST, false);
+    gl_state.enable(GL_BLEND, false);
+
+    yuyv_program.activate();
+    gl_state.bindTexture(0, GL_TEXTURE_2D, source);
+    gl_state.bindVertexArray(empty_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    gl_state.enable(GL_DEPTH_TEST, depth_test);
+    gl_state.enable(GL_BLEND, blend);
+    gl_state.bindFramebuffer(0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CameraTexture::reallocate(void)
+{
+    // called with mux held and no slot WRITING
+    const int width = requested_width, height = requested_height;
+    const Format format = requested_format;
+    clear();
+    requested_width = width;
+    requested_height = height;
+    requested_format = format;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &ID);
+    glTextureStorage2D(ID, 1, format == Format::YUYV ? GL_RGBA8 : GL_RGB8, width, height);
+    glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (format == Format::YUYV) {
+        // two pixels per texel, converted by texelFetch -> no filtering
+        glCreateTextures(GL_TEXTURE_2D, 1, &source);
+        glTextureStorage2D(source, 1, GL_RGBA8, width / 2, height);
+        glTextureParameteri(source, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(source, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glCreateFramebuffers(1, &FBO);
+        glNamedFramebufferTexture(FBO, GL_COLOR_ATTACHMENT0, ID, 0);
+        if (glCheckNamedFramebufferStatus(FBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("Camera YUYV framebuffer incomplete");
+        glCreateVertexArrays(1, &empty_VAO);
+        if (yuyv_program.getID() == 0)
+            yuyv_program = ShaderProgram("resources/deferred.vert", "resources/camera_yuyv.frag");
+    }
+
+    tex_format = format;
+    tex_width = width;
+    tex_height = height;
+
+    // slots aligned to 64 B (cache line) so each slot starts on its own line
+    slot_size = ((row_bytes() * height) + 63) & ~size_t(63);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &PBO);
+    glNamedBufferStorage(PBO, slot_size * SLOTS, nullptr, flags);
+    pbo_data = static_cast<unsigned char*>(glMapNamedBufferRange(PBO, 0, slot_size * SLOTS, flags));
+}
+
+void CameraTexture::clear(void)
+{
+    // render thread; capture thread must not be writing (see reallocate) or must be stopped
+    for (int i = 0; i < SLOTS; i++) {
+        if (slot_fence[i])
+            glDeleteSync(slot_fence[i]);
+        slot_fence[i] = nullptr;
+        slot[i] = Slot::FREE;
+    }
+    if (PBO) {
+        gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glUnmapNamedBuffer(PBO);
+        glDeleteBuffers(1, &PBO);
+    }
+    if (ID) {
+        gl_state.bindTexture(0, GL_TEXTURE_2D, 0);     // cached binding must not outlive the texture
+        glDeleteTextures(1, &ID);
+        glDeleteTextures(1, &source);
+    }
+    if (FBO) {
+        gl_state.bindFramebuffer(0);
+        glDeleteFramebuffers(1, &FBO);
+        gl_state.bindVertexArray(0);
+        glDeleteVertexArrays(1, &empty_VAO);
+    }
+    yuyv_program.clear();
+    PBO = 0;
+    ID = source = FBO = empty_VAO = 0;
+    pbo_data = nullptr;
+    slot_size = 0;
+    tex_width = tex_height = 0;
+    requested_width = requested_height = 0;
+}
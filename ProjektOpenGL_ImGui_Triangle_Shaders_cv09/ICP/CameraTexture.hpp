@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.hpp"
+#include "FrameSource.hpp"
+
+// Webcam image as GL texture, fed from the capture thread without stalling either thread.
+// Texture has immutable storage (re-created only when the camera resolution changes).
+// Frames go through a ring of SLOTS pixel unpack buffer slots (one persistently mapped buffer):
+//   capture thread - write() copies BGR frame into a free slot (no GL calls, no conversion)
+//   render thread  - update() uploads the newest written slot by glTextureSubImage2D from PBO
+//                    (GL_BGR source format) and fences the slot until GPU has read it
+// With three slots one can be read by GPU, one waits for upload and one is being written.
+// Older not uploaded frames are replaced by newer ones (latest frame wins).
+//
+// Raw YUYV (YUY2) frames are uploaded as they are (RGBA8 texture of half width, texel = Y0 U Y1 V)
+// and converted to RGB by a fullscreen pass (camera_yuyv.frag) into the texture returned by getID(),
+// so neither the driver nor CPU converts colours.
+//
+// Each frame keeps its capture timestamp, timestamp() / upload_time() describe the frame in the texture
+// (for capture -> upload -> present latency).
+class CameraTexture {
+public:
+    static constexpr int SLOTS = 3;
+
+    enum class Format { BGR, YUYV };
+
+    CameraTexture(void) = default;
+    ~CameraTexture() = default;     // GL objects are released by clear()
+
+    CameraTexture(const CameraTexture&) = delete;
+    CameraTexture& operator=(const CameraTexture&) = delete;
+
+    // capture thread: copy one frame (step = bytes per row), false = frame dropped
+    // (first frame of new resolution or format, buffers are re-created by next update())
+    bool write(const unsigned char* data, const int width, const int height, const size_t step, const Format format = Format::BGR,
+        const FrameTimestamp& timestamp = {});
+
+    // render thread, once per frame: upload newest frame, returns true if texture content changed
+    bool update(void);
+
+    GLuint getID(void) const { return ID; }     // RGB(A), sample as usual
+    int width(void) const { return tex_width; }
+    int height(void) const { return tex_height; }
+    Format format(void) const { return tex_format; }
+    const FrameTimestamp& timestamp(void) const { return tex_timestamp; }        // frame in texture
+    std::chrono::steady_clock::time_point upload_time(void) const { return tex_upload; }   // upload issued
+
+    // statistics, readable from any thread
+    std::atomic<unsigned long> uploaded{ 0 };   // frames, since start
+    std::atomic<unsigned long> dropped{ 0 };    // replaced by newer frame before upload, or no free slot
+
+    void clear(void);
+
+private:
+    enum class Slot { FREE, WRITING, WRITTEN, IN_FLIGHT };
+
+    void reallocate(void);          // render thread, with no slot being written
+    void convert_yuyv(void);        // source -> ID
+    size_t row_bytes(void) const { return size_t(tex_width) * (tex_format == Format::YUYV ? 2 : 3); }
+
+    std::mutex mux;                 // guards slot bookkeeping only (never held while copying)
+    Slot slot[SLOTS]{ Slot::FREE, Slot::FREE, Slot::FREE };
+    unsigned long long slot_sequence[SLOTS]{};
+    FrameTimestamp slot_timestamp[SLOTS];
+    unsigned long long sequence = 0;
+    int requested_width = 0, requested_height = 0;  // resolution seen by capture thread
+    Format requested_format = Format::BGR;
+
+    // render thread only (except pbo_data / slot_size, stable while any slot is WRITING)
+    GLsync slot_fence[SLOTS]{};
+    GLuint ID = 0;
+    GLuint PBO = 0;
+    unsigned char* pbo_data = nullptr;
+    size_t slot_size = 0;
+    int tex_width = 0, tex_height = 0;
+    Format tex_format = Format::BGR;
+    FrameTimestamp tex_timestamp;
+    std::chrono::steady_clock::time_point tex_upload{};
+
+    // YUYV only
+    GLuint source = 0;              // raw frame, RGBA8 width/2 x height
+    GLuint FBO = 0;                 // ID as colour attachment
+    GLuint empty_VAO = 0;
+    ShaderProgram yuyv_program;
+};
@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define COLOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)     // vaddvq_u8 is AArch64 only
+#define COLOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC / clang compile AVX2 code only in functions marked for it (the rest of the program stays SSE2)
+#if defined(COLOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#else
+#define TARGET_AVX2
+#endif
+
+#include "ColorDetect.hpp"
+
+bool color_match(const unsigned char b, const unsigned char g, const unsigned char r)
+{
+    const int v = std::max({ b, g, r });
+    const int m = std::min({ b, g, r });
+    if (v < 128 || v < 2 * m)
+        return false;
+    if (r == v)
+        return b > g;
+    if (g == v)
+        return false;
+    return 4 * r >= b + 3 * g;
+}
+
+static int count_row_scalar(const unsigned char* p, const int n)
+{
+    int count = 0;
+    for (int x = 0; x < n; x++, p += 3)
+        count += color_match(p[0], p[1], p[2]);
+    return count;
+}
+
+#if defined(COLOR_X86)
+
+static bool cpu_has_avx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)     // OS saves YMM registers
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// pshufb masks deinterleaving 16 BGR pixels (48 B in three 16 B parts) into B, G and R vectors;
+// byte k of the block is channel k % 3 of pixel k / 3, index with high bit set gives zero
+#define Z -128
+alignas(16) static const char deinterleave[9][16] = {
+    { 0, 3, 6, 9, 12, 15, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },   // B from part 0, 1, 2
+    { Z, Z, Z, Z, Z, Z, 2, 5, 8, 11, 14, Z, Z, Z, Z, Z },
+    { Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 1, 4, 7, 10, 13 },
+    { 1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },   // G
+    { Z, Z, Z, Z, Z, 0, 3, 6, 9, 12, 15, Z, Z, Z, Z, Z },
+    { Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 2, 5, 8, 11, 14 },
+    { 2, 5, 8, 11, 14, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z },   // R
+    { Z, Z, Z, Z, Z, 1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z },
+    { Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 0, 3, 6, 9, 12, 15 },
+};
+#undef Z
+
+TARGET_AVX2 static inline __m256i broadcast_mask(const int i)
+{
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(deinterleave[i])));
+}
+
+// part (16 B) of two consecutive 48 B blocks, one per 128-bit lane
+TARGET_AVX2 static inline __m256i load_parts(const unsigned char* p, const int offset)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + offset))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48 + offset)), 1);
+}
+
+TARGET_AVX2 static inline __m256i channel(const __m256i p0, const __m256i p1, const __m256i p2, const __m256i m0, const __m256i m1, const __m256i m2)
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(p0, m0), _mm256_shuffle_epi8(p1, m1)), _mm256_shuffle_epi8(p2, m2));
+}
+
+// unsigned a >= b  <=>  max(a, b) == a
+TARGET_AVX2 static inline __m256i ge(const __m256i a, const __m256i b)
+{
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+}
+
+// 32 pixels per step; each 128-bit lane deinterleaves 16 pixels (pshufb does not cross lanes),
+// lane 0 = pixels 0..15, lane 1 = pixels 16..31
+TARGET_AVX2 static int count_row_avx2(const unsigned char* p, const int n)
+{
+    const __m256i b0 = broadcast_mask(0), b1 = broadcast_mask(1), b2 = broadcast_mask(2);
+    const __m256i g0 = broadcast_mask(3), g1 = broadcast_mask(4), g2 = broadcast_mask(5);
+    const __m256i r0 = broadcast_mask(6), r1 = broadcast_mask(7), r2 = broadcast_mask(8);
+
+    const __m256i half = _mm256_set1_epi8(-128);   // 128
+    int count = 0, x = 0;
+    for (; x + 32 <= n; x += 32, p += 96) {
+        const __m256i p0 = load_parts(p, 0), p1 = load_parts(p, 16), p2 = load_parts(p, 32);
+        const __m256i b = channel(p0, p1, p2, b0, b1, b2);
+        const __m256i g = channel(p0, p1, p2, g0, g1, g2);
+        const __m256i r = channel(p0, p1, p2, r0, r1, r2);
+
+        const __m256i v = _mm256_max_epu8(_mm256_max_epu8(b, g), r);
+        const __m256i m = _mm256_min_epu8(_mm256_min_epu8(b, g), r);
+        const __m256i diff = _mm256_sub_epi8(v, m);
+        const __m256i sv = _mm256_and_si256(ge(v, half), ge(diff, m));     // V >= 128, V - m >= m
+
+        const __m256i r_max = _mm256_cmpeq_epi8(r, v);
+        const __m256i g_max = _mm256_cmpeq_epi8(g, v);
+        const __m256i b_gt_g = _mm256_xor_si256(ge(g, b), _mm256_set1_epi8(-1));
+        // B max: 4 (R - G) >= V - m, saturated 4 (R - G) is still >= diff when it saturates
+        __m256i rg = _mm256_subs_epu8(r, g);
+        rg = _mm256_adds_epu8(rg, rg);
+        rg = _mm256_adds_epu8(rg, rg);
+        const __m256i hue_b = _mm256_andnot_si256(_mm256_or_si256(r_max, g_max), ge(rg, diff));
+        const __m256i hue = _mm256_or_si256(_mm256_and_si256(r_max, b_gt_g), hue_b);
+
+        count += _mm_popcnt_u32(unsigned(_mm256_movemask_epi8(_mm256_and_si256(sv, hue))));
+    }
+    return count + count_row_scalar(p, n - x);
+}
+
+#elif defined(COLOR_NEON)
+
+static int count_row_neon(const unsigned char* p, const int n)
+{
+    const uint8x16_t half = vdupq_n_u8(128);
+    int count = 0, x = 0;
+    for (; x + 16 <= n; x += 16, p += 48) {
+        const uint8x16x3_t px = vld3q_u8(p);       // deinterleaves B, G, R
+        const uint8x16_t b = px.val[0], g = px.val[1], r = px.val[2];
+
+        const uint8x16_t v = vmaxq_u8(vmaxq_u8(b, g), r);
+        const uint8x16_t m = vminq_u8(vminq_u8(b, g), r);
+        const uint8x16_t diff = vsubq_u8(v, m);
+        const uint8x16_t sv = vandq_u8(vcgeq_u8(v, half), vcgeq_u8(diff, m));
+
+        const uint8x16_t r_max = vceqq_u8(r, v);
+        const uint8x16_t g_max = vceqq_u8(g, v);
+        uint8x16_t rg = vqsubq_u8(r, g);
+        rg = vqaddq_u8(rg, rg);
+        rg = vqaddq_u8(rg, rg);
+        const uint8x16_t hue_b = vbicq_u8(vcgeq_u8(rg, diff), vorrq_u8(r_max, g_max));
+        const uint8x16_t hue = vorrq_u8(vandq_u8(r_max, vcgtq_u8(b, g)), hue_b);
+
+        // 0xFF -> 1, horizontal sum (max 16, fits 8 bits)
+        count += vaddvq_u8(vshrq_n_u8(vandq_u8(sv, hue), 7));
+    }
+    return count + count_row_scalar(p, n - x);
+}
+
+#endif
+
+using RowKernel = int (*)(const unsigned char*, const int);
+
+static RowKernel best_kernel(void)
+{
+#if defined(COLOR_X86)
+    static const RowKernel kernel = cpu_has_avx2() ? count_row_avx2 : count_row_scalar;
+    return kernel;
+#elif defined(COLOR_NEON)
+    return count_row_neon;
+#else
+    return count_row_scalar;
+#endif
+}
+
+const char* color_kernel_name(void)
+{
+#if defined(COLOR_X86)
+    return best_kernel() == count_row_avx2 ? "AVX2" : "scalar";
+#elif defined(COLOR_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+int color_count(const cv::Mat& bgr, const int limit, const ColorKernel kernel)
+{
+    if (bgr.empty())
+        return 0;
+    if (bgr.type() != CV_8UC3)
+        throw std::runtime_error("color_count: CV_8UC3 frame expected");
+
+    const RowKernel count_row = (kernel == ColorKernel::SCALAR) ? count_row_scalar : best_kernel();
+
+    // continuous frame = one long row
+    const int rows = bgr.isContinuous() ? 1 : bgr.rows;
+    const int cols = bgr.isContinuous() ? int(bgr.total()) : bgr.cols;
+    // early exit is checked every chunk of pixels (a few rows of a typical frame)
+    const int chunk = (limit == INT_MAX) ? cols : 4096;
+
+    int count = 0;
+    for (int y = 0; y < rows; y++) {
+        const unsigned char* row = bgr.ptr<unsigned char>(y);
+        for (int x = 0; x < cols; x += chunk) {
+            count += count_row(row + size_t(x) * 3, std::min(chunk, cols - x));
+            if (count >= limit)
+                return count;
+        }
+    }
+    return count;
+}
+
+//
+// ColorClassifier
+//
+
+bool HsvRange::contains(const float h, const float s, const float v) const
+{
+    if (s < s_min || s > s_max || v < v_min || v > v_max)
+        return false;
+    if (h_min <= h_max)
+        return h >= h_min && h <= h_max;
+    return h >= h_min || h <= h_max;    // wraps around 180/0
+}
+
+// exact BGR -> HSV in OpenCV 8-bit units (H 0..180, S and V 0..255)
+static void bgr_to_hsv(const float b, const float g, const float r, float& h, float& s, float& v)
+{
+    v = std::max({ b, g, r });
+    const float diff = v - std::min({ b, g, r });
+    s = (v > 0.0f) ? 255.0f * diff / v : 0.0f;
+    if (diff == 0.0f)
+        h = 0.0f;
+    else if (v == r)
+        h = 60.0f * (g - b) / diff;
+    else if (v == g)
+        h = 120.0f + 60.0f * (b - r) / diff;
+    else
+        h = 240.0f + 60.0f * (r - g) / diff;
+    if (h < 0.0f)
+        h += 360.0f;
+    h *= 0.5f;
+}
+
+ColorClassifier::ColorClassifier(std::vector<ColorClass> classes, const int bits) : color_classes(std::move(classes)), bits(bits), shift(8 - bits)
+{
+    if (color_classes.size() > MAX_CLASSES)
+        throw std::runtime_error("ColorClassifier: at most " + std::to_string(MAX_CLASSES) + " colour classes");
+    if (bits < 4 || bits > 8)
+        throw std::runtime_error("ColorClassifier: 4 to 8 bits per channel");
+
+    // every cell classified by its centre colour
+    const int cells = 1 << bits;
+    const float step = float(1 << shift), centre = 0.5f * (step - 1.0f);
+    lut.assign(size_t(1) << (3 * bits), 0);
+    for (int qb = 0; qb < cells; qb++)
+        for (int qg = 0; qg < cells; qg++)
+            for (int qr = 0; qr < cells; qr++) {
+                float h, s, v;
+                bgr_to_hsv(qb * step + centre, qg * step + centre, qr * step + centre, h, s, v);
+                uint8_t found = 0;
+                for (size_t c = 0; c < color_classes.size() && !found; c++)
+                    for (auto const& range : color_classes[c].ranges)
+                        if (range.contains(h, s, v)) {
+                            found = uint8_t(c + 1);
+                            break;
+                        }
+                lut[(size_t(qb) << (2 * bits)) | (size_t(qg) << bits) | size_t(qr)] = found;
+            }
+}
+
+std::vector<ColorClass> ColorClassifier::load(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Can not open colour classes: " + path.string());
+
+    std::vector<ColorClass> classes;
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name))
+            continue;   // empty or comment
+        HsvRange range{};
+        if (!(fields >> range.h_min >> range.h_max >> range.s_min >> range.s_max >> range.v_min >> range.v_max))
+            throw std::runtime_error(path.string() + ":" + std::to_string(number) + ": expected name h_min h_max s_min s_max v_min v_max");
+
+        auto it = std::find_if(classes.begin(), classes.end(), [&](ColorClass const& c) { return c.name == name; });
+        if (it == classes.end())
+            it = classes.insert(classes.end(), ColorClass{ name, {} });
+        it->ranges.push_back(range);
+    }
+    return classes;
+}
+
+std::vector<ColorClass> ColorClassifier::defaults(void)
+{
+    return {
+        { "red",    { { 170, 10, 128, 255, 128, 255 } } },     // wraps around 0
+        { "yellow", { { 20, 35, 128, 255, 128, 255 } } },
+        { "green",  { { 40, 85, 100, 255, 64, 255 } } },
+        { "blue",   { { 100, 130, 128, 255, 64, 255 } } },
+    };
+}
+
+static void check_frame(const cv::Mat& bgr)
+{
+    if (bgr.type() != CV_8UC3)
+        throw std::runtime_error("ColorClassifier: CV_8UC3 frame expected");
+}
+
+ColorClassifier::Counts ColorClassifier::classify(const cv::Mat& bgr) const
+{
+    if (bgr.empty() || lut.empty())
+        return {};
+    check_frame(bgr);
+    // continuous frame = one long row
+    if (bgr.isContinuous())
+        return classify_rows(bgr.ptr<unsigned char>(0), 0, 1, int(bgr.total()));
+    return classify_rows(bgr.ptr<unsigned char>(0), bgr.step, bgr.rows, bgr.cols);
+}
+
+ColorClassifier::Counts ColorClassifier::classify(const cv::Mat& bgr, const cv::Rect& rect, Boxes* boxes) const
+{
+    const cv::Rect r = rect & cv::Rect(0, 0, bgr.cols, bgr.rows);
+    if (r.empty() || lut.empty())
+        return {};
+    check_frame(bgr);
+    return classify_rows(bgr.ptr<unsigned char>(r.y) + size_t(r.x) * 3, bgr.step, r.height, r.width, boxes, r.tl());
+}
+
+ColorClassifier::Counts ColorClassifier::classify_rows(const unsigned char* data, const size_t step, const int rows, const int cols,
+    Boxes* boxes, const cv::Point origin) const
+{
+    // four histograms, so neighbouring pixels of the same class do not wait for each other's increment
+    int histogram[4][MAX_CLASSES + 1]{};
+    const uint8_t* table = lut.data();
+    const int b = bits, s = shift;
+    for (int y = 0; y < rows; y++) {
+        const unsigned char* p = data + step * y;
+        int x = 0;
+        if (!boxes) {
+            for (; x + 4 <= cols; x += 4, p += 12) {
+                histogram[0][table[index(p[0], p[1], p[2], b, s)]]++;
+                histogram[1][table[index(p[3], p[4], p[5], b, s)]]++;
+                histogram[2][table[index(p[6], p[7], p[8], b, s)]]++;
+                histogram[3][table[index(p[9], p[10], p[11], b, s)]]++;
+            }
+            for (; x < cols; x++, p += 3)
+                histogram[0][table[index(p[0], p[1], p[2], b, s)]]++;
+        }
+        else {
+            // first and last pixel of each class in the row without branches (class 0 = none is tracked too),
+            // same four-way unroll as above, first split four ways like histogram; boxes updated once per row
+            int first[4][MAX_CLASSES + 1], last[MAX_CLASSES + 1];
+            std::fill(&first[0][0], &first[0][0] + 4 * (MAX_CLASSES + 1), INT_MAX);
+            std::fill(std::begin(last), std::end(last), -1);
+            for (; x + 4 <= cols; x += 4, p += 12) {
+                const int c0 = table[index(p[0], p[1], p[2], b, s)];
+                const int c1 = table[index(p[3], p[4], p[5], b, s)];
+                const int c2 = table[index(p[6], p[7], p[8], b, s)];
+                const int c3 = table[index(p[9], p[10], p[11], b, s)];
+                histogram[0][c0]++;
+                histogram[1][c1]++;
+                histogram[2][c2]++;
+                histogram[3][c3]++;
+                first[0][c0] = std::min(first[0][c0], x);
+                first[1][c1] = std::min(first[1][c1], x + 1);
+                first[2][c2] = std::min(first[2][c2], x + 2);
+                first[3][c3] = std::min(first[3][c3], x + 3);
+                last[c0] = x;           // in pixel order, the rightmost store wins
+                last[c1] = x + 1;
+                last[c2] = x + 2;
+                last[c3] = x + 3;
+            }
+            for (; x < cols; x++, p += 3) {
+                const int c = table[index(p[0], p[1], p[2], b, s)];
+                histogram[0][c]++;
+                first[0][c] = std::min(first[0][c], x);
+                last[c] = x;
+            }
+            for (int c = 1; c <= MAX_CLASSES; c++)
+                if (last[c] >= 0) {
+                    const int x0 = std::min({ first[0][c], first[1][c], first[2][c], first[3][c] });
+                    (*boxes)[c - 1].add(origin.x + x0, origin.y + y);
+                    (*boxes)[c - 1].add(origin.x + last[c], origin.y + y);
+                }
+        }
+    }
+
+    Counts counts{};
+    for (int c = 0; c < MAX_CLASSES; c++)
+        counts[c] = histogram[0][c + 1] + histogram[1][c + 1] + histogram[2][c + 1] + histogram[3][c + 1];
+    return counts;
+}
+
+void ColorClassifier::mask(const cv::Mat& bgr, const cv::Rect& rect, const int c, cv::Mat& mask) const
+{
+    check_frame(bgr);
+    if (mask.type() != CV_8UC1 || mask.rows != rect.height || mask.cols != rect.width)
+        throw std::runtime_error("ColorClassifier: mask does not match rect");
+
+    const uint8_t* table = lut.data();
+    const int b = bits, s = shift;
+    const uint8_t wanted = uint8_t(c + 1);
+    for (int y = 0; y < rect.height; y++) {
+        const unsigned char* p = bgr.ptr<unsigned char>(rect.y + y) + size_t(rect.x) * 3;
+        unsigned char* m = mask.ptr<unsigned char>(y);
+        for (int x = 0; x < rect.width; x++, p += 3)
+            m[x] = (table[index(p[0], p[1], p[2], b, s)] == wanted) ? 255 : 0;
+    }
+}
+
+bool ColorClassifier::any_sampled(const cv::Mat& bgr, const cv::Rect& rect, const int step) const
+{
+    const cv::Rect r = rect & cv::Rect(0, 0, bgr.cols, bgr.rows);
+    if (r.empty() || lut.empty())
+        return false;
+    check_frame(bgr);
+
+    // samples in the middle of each step x step cell
+    const uint8_t* table = lut.data();
+    for (int y = r.y + step / 2; y < r.y + r.height; y += step) {
+        const unsigned char* row = bgr.ptr<unsigned char>(y);
+        for (int x = r.x + step / 2; x < r.x + r.width; x += step) {
+            const unsigned char* p = row + size_t(x) * 3;
+            if (table[index(p[0], p[1], p[2])])
+                return true;
+        }
+    }
+    return false;
+}
+
+//
+// TiledColorDetector
+//
+
+ColorDetection TiledColorDetector::detect(const ColorClassifier& classifier, const cv::Mat& bgr, const int coarse_step)
+{
+    if (bgr.empty())
+        return {};
+
+    const int size = std::max(16, tile_size);
+    const int tiles_x = (bgr.cols + size - 1) / size, tiles_y = (bgr.rows + size - 1) / size;
+    const size_t count = size_t(tiles_x) * tiles_y;
+    tiles.resize(count);       // keeps capacity, no allocation for the same resolution
+    auto tile_rect = [&](const size_t t) { return cv::Rect(int(t % tiles_x) * size, int(t / tiles_x) * size, size, size); };
+
+    work.clear();
+    if (coarse_step > 1) {
+        // coarse: sparse samples of every tile
+        pool.parallel_for(count, [&](size_t t) {
+            tiles[t].candidate = classifier.any_sampled(bgr, tile_rect(t), coarse_step);
+        });
+        // fine: tiles with a candidate and their neighbours (object may reach over the tile edge between samples)
+        for (int ty = 0; ty < tiles_y; ty++)
+            for (int tx = 0; tx < tiles_x; tx++) {
+                bool near = false;
+                for (int ny = std::max(0, ty - 1); ny <= std::min(tiles_y - 1, ty + 1) && !near; ny++)
+                    for (int nx = std::max(0, tx - 1); nx <= std::min(tiles_x - 1, tx + 1) && !near; nx++)
+                        near = tiles[size_t(ny) * tiles_x + nx].candidate;
+                if (near)
+                    work.push_back(size_t(ty) * tiles_x + tx);
+            }
+    }
+    else {
+        for (size_t t = 0; t < count; t++)
+            work.push_back(t);
+    }
+
+    // full resolution, each tile into its own counts (no candidate anywhere = nothing to do)
+    if (!work.empty())
+        pool.parallel_for(work.size(), [&](size_t i) {
+            Tile& tile = tiles[work[i]];
+            tile.boxes = {};
+            tile.counts = classifier.classify(bgr, tile_rect(work[i]), &tile.boxes);
+        });
+
+    // coarse samples: tiles of one column / row share their sample count
+    size_t examined = 0;
+    if (coarse_step > 1) {
+        auto samples = [&](const int length, const int tile_count) {
+            size_t n = 0;
+            for (int i = 0; i < tile_count; i++) {
+                const int l = std::min(size, length - i * size);
+                if (l > coarse_step / 2)
+                    n += (l - coarse_step / 2 + coarse_step - 1) / coarse_step;
+            }
+            return n;
+        };
+        examined = samples(bgr.cols, tiles_x) * samples(bgr.rows, tiles_y);
+    }
+
+    const cv::Rect frame(0, 0, bgr.cols, bgr.rows);
+    ColorDetection result;
+    for (size_t t : work) {
+        examined += size_t((tile_rect(t) & frame).area());     // edge tiles are clipped
+        for (int c = 0; c < ColorClassifier::MAX_CLASSES; c++) {
+            result.pixels[c] += tiles[t].counts[c];
+            result.boxes[c].add(tiles[t].boxes[c]);
+        }
+    }
+
+    tiles_total = int(count);
+    tiles_examined = int(work.size());
+    pixels_examined = examined;
+    return result;
+}
+
+//
+// benchmark
+//
+
+// original detection: HSV image, mask, pixel by pixel sum of 0/255 mask
+static int count_opencv(const cv::Mat& bgr, cv::Mat& hsv, cv::Mat& mask)
+{
+    cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+    cv::inRange(hsv, cv::Scalar(128.0, 128.0, 128.0), cv::Scalar(255.0, 255.0, 255.0), mask);
+    int sum = 0;
+    for (int y = 0; y < mask.rows; y++)
+        for (int x = 0; x < mask.cols; x++)
+            sum += mask.at<uchar>(y, x);
+    return sum / 255;
+}
+
+void color_benchmark(std::ostream& out)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    const int repeats = 20;
+
+    const ColorClassifier classifier(ColorClassifier::defaults());
+    ThreadPool pool;
+    TiledColorDetector tiled(pool);
+    out << "Colour detection benchmark, kernel " << color_kernel_name() << ", " << pool.size() + 1 << " threads, ms per frame (average of "
+        << repeats << ")\n";
+    for (const cv::Size size : { cv::Size(1920, 1080), cv::Size(3840, 2160) }) {
+        // random noise: worst case for branches, matches everywhere
+        cv::Mat noise(size, CV_8UC3);
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+        // typical scene: dull background, one red object
+        cv::Mat scene(size, CV_8UC3, cv::Scalar(96, 96, 80));
+        for (cv::Mat* frame : { &noise, &scene })
+            cv::circle(*frame, cv::Point(size.width / 2, size.height * 3 / 4), size.height / 12, cv::Scalar(60, 0, 255), cv::FILLED);
+
+        cv::Mat hsv, mask;
+        auto measure = [&](const char* name, const cv::Mat& frame, auto&& detect) {
+            int result = detect(frame);     // warm-up (allocations, caches)
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; i++)
+                result = detect(frame);
+            const double time = ms(std::chrono::steady_clock::now() - start).count() / repeats;
+            out << "  " << size.width << "x" << size.height << "  " << name << ": " << time << " ms (" << result << " pixels)\n";
+        };
+
+        measure("noise  HSV + inRange + at<>  ", noise, [&](const cv::Mat& f) { return count_opencv(f, hsv, mask); });
+        measure("noise  scalar kernel         ", noise, [&](const cv::Mat& f) { return color_count(f, INT_MAX, ColorKernel::SCALAR); });
+        measure("noise  SIMD kernel           ", noise, [&](const cv::Mat& f) { return color_count(f); });
+        measure("noise  SIMD, at least 1000   ", noise, [&](const cv::Mat& f) { return color_count(f, 1000); });
+        measure("noise  LUT, 4 classes        ", noise, [&](const cv::Mat& f) { return classifier.classify(f)[0]; });
+        measure("noise  LUT tiled             ", noise, [&](const cv::Mat& f) { return tiled.detect(classifier, f).pixels[0]; });
+        measure("scene  LUT, 4 classes        ", scene, [&](const cv::Mat& f) { return classifier.classify(f)[0]; });
+        measure("scene  LUT tiled             ", scene, [&](const cv::Mat& f) { return tiled.detect(classifier, f).pixels[0]; });
+        measure("scene  LUT tiled, coarse 4   ", scene, [&](const cv::Mat& f) { return tiled.detect(classifier, f, 4).pixels[0]; });
+    }
+}
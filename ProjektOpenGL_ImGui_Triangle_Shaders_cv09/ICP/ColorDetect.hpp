@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "ThreadPool.hpp"
+
+// Colour detection straight on BGR8 pixels, one pass, no HSV image and no mask.
+// Criterion is the one of cv::cvtColor(COLOR_BGR2HSV) + cv::inRange(H, S, V >= 128), i.e. with
+// V = max(B,G,R), m = min(B,G,R):
+//   V >= 128, V >= 2m                     (value, saturation)
+//   R is max and B > G                    (hue 300..360 deg)
+//   or B is max (not R, not G) and 4R >= B + 3G    (hue 255..300 deg)
+// Hue and saturation are exact here, OpenCV's are fixed-point and rounded, so 30 247 of all 2^24 colours
+// (0.18 %) differ: most lie near the hue bounds 255 / 360 deg (reds just below 360 deg round to 0),
+// 3 408 on the saturation bound, where OpenCV's rounded S >= 128 and the exact V >= 2m disagree.
+// Everything stays in 8-bit integers, so SIMD lanes stay 8-bit (32 pixels per AVX2 step, 16 per NEON step).
+// Kernel is chosen at run time (AVX2 if CPU supports it), NEON on ARM, scalar otherwise.
+// The app classifies through ColorClassifier below; this kernel is kept as the baseline of --benchmark-color.
+
+enum class ColorKernel { BEST, SCALAR };
+
+// number of matching pixels of CV_8UC3 frame; counting stops once limit is reached
+// (early exit, result is then >= limit, e.g. limit 1 = "is there any")
+int color_count(const cv::Mat& bgr, const int limit = INT_MAX, const ColorKernel kernel = ColorKernel::BEST);
+
+bool color_match(const unsigned char b, const unsigned char g, const unsigned char r);   // single pixel
+const char* color_kernel_name(void);    // kernel used by ColorKernel::BEST
+
+// HSV box in OpenCV 8-bit units: H 0..179 (degrees / 2), S and V 0..255, bounds inclusive.
+// h_min > h_max wraps around 180/0, e.g. red is { 170, 10, ... }.
+struct HsvRange {
+    int h_min, h_max;
+    int s_min, s_max;
+    int v_min, v_max;
+
+    bool contains(const float h, const float s, const float v) const;
+};
+
+// named colour = union of HSV ranges
+struct ColorClass {
+    std::string name;
+    std::vector<HsvRange> ranges;
+};
+
+// bounding box of pixels, inclusive corners
+struct ColorBox {
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = -1, y1 = -1;
+
+    bool empty(void) const { return x1 < x0; }
+    void add(const int x, const int y) {
+        x0 = std::min(x0, x); y0 = std::min(y0, y);
+        x1 = std::max(x1, x); y1 = std::max(y1, y);
+    }
+    void add(const ColorBox& b) {
+        if (!b.empty()) {
+            add(b.x0, b.y0);
+            add(b.x1, b.y1);
+        }
+    }
+    cv::Rect rect(void) const { return empty() ? cv::Rect() : cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1); }
+};
+
+// Several colour classes classified at once through a lookup table indexed by quantized BGR
+// (bits per channel, default 5 -> 32x32x32 cells, 32 kB, fits L1). Each cell holds the first class
+// whose ranges contain the colour of the cell centre, so one pass over the frame costs one table
+// load per pixel for all classes together. Overlapping classes: the one listed first wins.
+class ColorClassifier {
+public:
+    static constexpr int MAX_CLASSES = 8;
+    using Counts = std::array<int, MAX_CLASSES>;   // pixels per class, in class order
+    using Boxes = std::array<ColorBox, MAX_CLASSES>;
+
+    ColorClassifier(void) = default;
+    explicit ColorClassifier(std::vector<ColorClass> classes, const int bits = 5);
+
+    // text file, one range per line: name h_min h_max s_min s_max v_min v_max (# comments);
+    // lines with the same name add ranges to one class
+    static std::vector<ColorClass> load(const std::filesystem::path& path);
+    static std::vector<ColorClass> defaults(void);     // red, yellow, green, blue
+
+    // CV_8UC3 frame -> pixel counts of all classes (const, may run on several threads at once)
+    Counts classify(const cv::Mat& bgr) const;
+    // part of the frame, optionally with bounding boxes of each class (frame coordinates)
+    Counts classify(const cv::Mat& bgr, const cv::Rect& rect, Boxes* boxes = nullptr) const;
+    // mask (CV_8UC1, rect size, 255 = pixel of class c) of rect; mask must already have rect's size
+    void mask(const cv::Mat& bgr, const cv::Rect& rect, const int c, cv::Mat& mask) const;
+    // any pixel of any class among samples in the middle of each step x step cell of rect
+    bool any_sampled(const cv::Mat& bgr, const cv::Rect& rect, const int step) const;
+    int classify(const unsigned char b, const unsigned char g, const unsigned char r) const {   // class index, -1 = none
+        return int(lut[index(b, g, r)]) - 1;
+    }
+
+    const std::vector<ColorClass>& classes(void) const { return color_classes; }
+    // lookup table as it is (e.g. for the GPU): cell index = B << 2 * bits | G << bits | R, each channel >> (8 - bits)
+    const std::vector<uint8_t>& table(void) const { return lut; }
+    int table_bits(void) const { return bits; }
+
+private:
+    // boxes (if any) get positions offset by origin
+    Counts classify_rows(const unsigned char* data, const size_t step, const int rows, const int cols,
+        Boxes* boxes = nullptr, const cv::Point origin = {}) const;
+
+    size_t index(const unsigned char b, const unsigned char g, const unsigned char r) const {
+        return index(b, g, r, bits, shift);
+    }
+    // with bits / shift in locals: stores into int counters could alias the members otherwise
+    static size_t index(const unsigned char b, const unsigned char g, const unsigned char r, const int bits, const int shift) {
+        return (size_t(b >> shift) << (2 * bits)) | (size_t(g >> shift) << bits) | size_t(r >> shift);
+    }
+
+    std::vector<ColorClass> color_classes;
+    int bits = 5, shift = 3;
+    std::vector<uint8_t> lut;       // class + 1, 0 = no class
+};
+
+// pixel counts and bounding boxes of all classes in one frame
+struct ColorDetection {
+    ColorClassifier::Counts pixels{};
+    ColorClassifier::Boxes boxes{};
+};
+
+// Frame split into tile_size x tile_size tiles classified in parallel on a ThreadPool; every tile
+// counts into its own slot (merged afterwards, nothing shared in the inner loop).
+// Coarse-to-fine (coarse_step > 1): all tiles are scanned at one pixel per coarse_step x coarse_step cell
+// first, then only tiles with a candidate, or next to one, are classified at full resolution.
+// Counts of examined tiles are exact; an object smaller than coarse_step pixels can be missed.
+// One detect() at a time (tile buffers are reused between frames).
+// Bounding boxes cover the examined tiles, i.e. all counted pixels.
+
+class TiledColorDetector {
+public:
+    explicit TiledColorDetector(ThreadPool& pool, const int tile_size = 128) : tile_size(tile_size), pool(pool) {}
+
+    ColorDetection detect(const ColorClassifier& classifier, const cv::Mat& bgr, const int coarse_step = 0);
+
+    int tile_size;
+    // last detect(), readable from other threads
+    std::atomic<int> tiles_total{ 0 }, tiles_examined{ 0 };
+    std::atomic<size_t> pixels_examined{ 0 };   // coarse samples (upper bound, a tile stops at its first hit) + examined tiles
+
+private:
+    struct alignas(64) Tile {       // own cache lines, tiles are written by different threads
+        ColorClassifier::Counts counts{};
+        ColorClassifier::Boxes boxes{};
+        bool candidate = false;
+    };
+
+    ThreadPool& pool;
+    std::vector<Tile> tiles;
+    std::vector<size_t> work;       // tiles classified at full resolution
+};
+
+// compares OpenCV HSV + inRange + at<> loop, scalar and SIMD kernels (full count and early exit)
+// and the lookup table classifier (whole frame, tiled, coarse-to-fine) on 1080p and 4K frames, prints ms per frame
+void color_benchmark(std::ostream& out);
@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "ColorTracker.hpp"
+
+ColorTrack ColorTracker::update(const ColorClassifier& classifier, TiledColorDetector& detector, const cv::Mat& bgr, const int coarse_step,
+    ColorDetection& detection)
+{
+    ColorTrack track;
+    const cv::Rect frame(0, 0, bgr.cols, bgr.rows);
+    if (bgr.empty() || class_index < 0 || class_index >= int(classifier.classes().size())) {
+        locked = false;
+        detection = {};
+        return track;
+    }
+    if (mask_buffer.rows != bgr.rows || mask_buffer.cols != bgr.cols)
+        mask_buffer.create(bgr.rows, bgr.cols, CV_8UC1);
+
+    if (locked) {
+        // window around the predicted position
+        const int grow_x = std::max(min_margin, int(last.box.width * margin)), grow_y = std::max(min_margin, int(last.box.height * margin));
+        const cv::Rect predicted(last.box.x + int(velocity.x) - grow_x, last.box.y + int(velocity.y) - grow_y,
+            last.box.width + 2 * grow_x, last.box.height + 2 * grow_y);
+        track.window = predicted & frame;
+
+        detection = {};
+        detection.pixels = classifier.classify(bgr, track.window, &detection.boxes);
+        track.pixels_examined = track.window.area();
+        const cv::Rect region = detection.boxes[class_index].rect();
+        if (detection.pixels[class_index] >= min_area && find(classifier, bgr, region, track))
+            track.pixels_examined += region.area();     // mask pass
+        else
+            locked = false;     // lost, full scan below
+    }
+
+    if (!locked) {
+        track.full_scan = true;
+        track.window = frame;
+        detection = detector.detect(classifier, bgr, coarse_step);
+        track.pixels_examined += detector.pixels_examined;     // after a loss in the window, both searches count
+        const cv::Rect region = detection.boxes[class_index].rect();
+        if (detection.pixels[class_index] >= min_area && find(classifier, bgr, region, track))
+            track.pixels_examined += region.area();
+    }
+
+    if (track.found) {
+        velocity = locked ? track.centroid - last.centroid : cv::Point2f();
+        locked = true;
+        last = track;
+    }
+    else {
+        velocity = cv::Point2f();
+    }
+    return track;
+}
+
+bool ColorTracker::find(const ColorClassifier& classifier, const cv::Mat& bgr, const cv::Rect& rect, ColorTrack& track)
+{
+    if (rect.empty())
+        return false;
+
+    cv::Mat mask = mask_buffer(cv::Rect(0, 0, rect.width, rect.height));
+    classifier.mask(bgr, rect, class_index, mask);
+    const int count = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+
+    // label 0 is background
+    int best = -1;
+    for (int i = 1; i < count; i++)
+        if (best < 0 || stats.at<int>(i, cv::CC_STAT_AREA) > stats.at<int>(best, cv::CC_STAT_AREA))
+            best = i;
+    if (best < 0 || stats.at<int>(best, cv::CC_STAT_AREA) < min_area)
+        return false;
+
+    track.found = true;
+    track.area = stats.at<int>(best, cv::CC_STAT_AREA);
+    track.box = cv::Rect(rect.x + stats.at<int>(best, cv::CC_STAT_LEFT), rect.y + stats.at<int>(best, cv::CC_STAT_TOP),
+        stats.at<int>(best, cv::CC_STAT_WIDTH), stats.at<int>(best, cv::CC_STAT_HEIGHT));
+    track.centroid = cv::Point2f(float(rect.x + centroids.at<double>(best, 0)), float(rect.y + centroids.at<double>(best, 1)));
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "ColorDetect.hpp"
+
+// tracked blob of one frame
+struct ColorTrack {
+    bool found = false;
+    bool full_scan = false;         // whole frame searched (not locked, or lost in the window)
+    cv::Rect window;                // searched area (whole frame on full scan)
+    cv::Rect box;                   // tracked blob
+    cv::Point2f centroid;
+    int area = 0;                   // pixels of the blob
+    size_t pixels_examined = 0;     // read this frame: window or coarse samples + tiles, mask pass
+};
+
+// Follows the largest 8-connected blob of one colour class from frame to frame.
+// Not locked: the whole frame goes through TiledColorDetector (coarse-to-fine), components are then
+// looked for in the bounding box of the class (cv::connectedComponentsWithStats on a mask of it).
+// Locked: only a window around the last box, grown by margin of its size and moved by the last motion,
+// is classified (single-threaded, usually a small part of the frame). Blob not found there -> full scan
+// in the same frame. detection then holds counts and boxes of the searched area only.
+// One thread at a time (analyze stage), buffers are reused between frames.
+class ColorTracker {
+public:
+    int class_index = 0;            // ColorClassifier class
+    int min_area = 16;              // smaller blobs are noise
+    float margin = 0.5f;            // window grows by margin * box size on every side ...
+    int min_margin = 16;            // ... at least this many pixels
+
+    ColorTrack update(const ColorClassifier& classifier, TiledColorDetector& detector, const cv::Mat& bgr, const int coarse_step,
+        ColorDetection& detection);
+    void reset(void) { locked = false; }
+
+private:
+    // largest blob in rect, true if it has min_area
+    bool find(const ColorClassifier& classifier, const cv::Mat& bgr, const cv::Rect& rect, ColorTrack& track);
+
+    bool locked = false;
+    ColorTrack last;
+    cv::Point2f velocity;           // centroid motion per frame
+
+    cv::Mat mask_buffer;            // frame sized, searched rect uses its top-left part
+    cv::Mat labels, stats, centroids;
+};
@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+#include "FramePool.hpp"
+
+namespace {
+    constexpr size_t header_stride = (sizeof(cv::UMatData) + alignof(cv::UMatData) - 1) / alignof(cv::UMatData) * alignof(cv::UMatData);
+}
+
+FramePool::~FramePool()
+{
+    // all Mats using the pool must be released by now (declare the pool before them)
+    for (unsigned char* block : block_data)
+        cv::fastFree(block);
+}
+
+void FramePool::reserve(const size_t block_bytes, const int block_count)
+{
+    std::lock_guard<std::mutex> lock(mux);
+    if (!block_data.empty())
+        throw std::runtime_error("FramePool: already reserved");
+
+    this->block_bytes = block_bytes;
+    for (int i = 0; i < block_count; i++)
+        block_data.push_back(static_cast<unsigned char*>(cv::fastMalloc(block_bytes)));    // 64 B aligned
+    header_storage.resize(header_stride * block_count + alignof(cv::UMatData));
+    in_use.assign(block_count, false);
+}
+
+cv::UMatData* FramePool::header(const int block) const
+{
+    // header_storage is over-allocated by one alignment unit
+    uintptr_t base = reinterpret_cast<uintptr_t>(header_storage.data());
+    base = (base + alignof(cv::UMatData) - 1) / alignof(cv::UMatData) * alignof(cv::UMatData);
+    return reinterpret_cast<cv::UMatData*>(base + header_stride * block);
+}
+
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const
+{
+    // total size and steps, same as OpenCV standard allocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data && step[i] != CV_AUTOSTEP)
+                total = step[i];
+            else
+                step[i] = total;
+        }
+        total *= sizes[i];
+    }
+
+    if (data == nullptr && total <= block_bytes) {
+        std::lock_guard<std::mutex> lock(mux);
+        for (int i = 0; i < blocks(); i++) {
+            if (in_use[i])
+                continue;
+            in_use[i] = true;
+            cv::UMatData* u = new (header(i)) cv::UMatData(this);
+            u->data = u->origdata = block_data[i];
+            u->size = total;
+            pooled_count++;
+            return u;
+        }
+    }
+
+    // user data (not ours), too large or pool exhausted
+    if (data == nullptr)
+        heap_count++;
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+}
+
+bool FramePool::allocate(cv::UMatData* data, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    return data != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData* u) const
+{
+    if (!u)
+        return;
+
+    std::lock_guard<std::mutex> lock(mux);
+    for (int i = 0; i < blocks(); i++) {
+        if (u == header(i)) {
+            u->~UMatData();
+            in_use[i] = false;
+            return;
+        }
+    }
+}
+
+int FramePool::blocks_in_use(void) const
+{
+    std::lock_guard<std::mutex> lock(mux);
+    int count = 0;
+    for (bool used : in_use)
+        count += used;
+    return count;
+}
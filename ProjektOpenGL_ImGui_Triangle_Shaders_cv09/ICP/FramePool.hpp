@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Fixed pool of preallocated camera frame buffers, used as cv::MatAllocator.
+// Mats of the capture pipeline get this allocator (attach() before their first create()),
+// so their pixel data and UMatData headers come from blocks reserved once at start-up
+// and are recycled when a Mat releases them. Requests larger than a block, or when all
+// blocks are taken, fall back to the standard OpenCV allocator and are counted as heap allocations.
+//
+// Mats keep their buffer while size and type stay the same, so after warm-up the pipeline
+// should not allocate at all; allocations_since_warm_up() shows it.
+class FramePool : public cv::MatAllocator {
+public:
+    FramePool(void) = default;
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // once, before any attached Mat is created (e.g. when camera resolution is known)
+    void reserve(const size_t block_bytes, const int block_count);
+    void attach(cv::Mat& mat) { mat.allocator = this; }
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    int blocks(void) const { return int(block_data.size()); }
+    int blocks_in_use(void) const;
+    size_t block_size(void) const { return block_bytes; }
+
+    // counters, updated from any thread
+    unsigned long allocations(void) const { return pooled_count + heap_count; }
+    unsigned long heap_allocations(void) const { return heap_count; }
+    void mark_warm_up(void) { warm_up_count = allocations(); }     // pipeline is running, buffers should be reused from now on
+    unsigned long allocations_since_warm_up(void) const { return allocations() - warm_up_count; }
+
+private:
+    size_t block_bytes = 0;
+    std::vector<unsigned char*> block_data;
+    std::vector<unsigned char> header_storage;      // one cv::UMatData per block (placement new)
+    cv::UMatData* header(const int block) const;
+
+    mutable std::mutex mux;                         // guards in_use
+    mutable std::vector<bool> in_use;
+
+    mutable std::atomic<unsigned long> pooled_count{ 0 };
+    mutable std::atomic<unsigned long> heap_count{ 0 };
+    std::atomic<unsigned long> warm_up_count{ 0 };
+};
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "FrameSource.hpp"
+
+std::chrono::steady_clock::duration FrameSource::frame_period(void) const
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps()));
+}
+
+void FrameSource::stamp(const double device_ms)
+{
+    last_timestamp.captured = std::chrono::steady_clock::now();
+    last_timestamp.device_ms = device_ms;
+}
+
+void FrameSource::pace(void)
+{
+    if (!realtime)
+        return;
+
+    const auto period = frame_period();
+    const auto now = std::chrono::steady_clock::now();
+    if (next_frame.time_since_epoch().count() == 0 || now - next_frame > period)
+        next_frame = now;   // first frame, or too late (do not catch up by bursts)
+    else
+        std::this_thread::sleep_until(next_frame);
+    next_frame += period;
+}
+
+std::unique_ptr<FrameSource> FrameSource::from_args(int argc, char* argv[])
+{
+    std::unique_ptr<FrameSource> source;
+    bool realtime = true;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--camera" && has_value) {
+            source = std::make_unique<DeviceSource>(std::stoi(argv[++i]));
+        }
+        else if (arg == "--video" && has_value) {
+            source = std::make_unique<VideoFileSource>(argv[++i]);
+        }
+        else if (arg == "--images" && has_value) {
+            source = std::make_unique<ImageSequenceSource>(argv[++i]);
+        }
+        else if (arg == "--synthetic" && has_value) {
+            int width = 0, height = 0;
+            double fps = 0.0;
+            if (std::sscanf(argv[++i], "%dx%d@%lf", &width, &height, &fps) != 3 || width <= 0 || height <= 0 || fps <= 0.0)
+                throw std::runtime_error(std::string("Synthetic source expects WxH@FPS, got: ") + argv[i]);
+            source = std::make_unique<SyntheticSource>(width, height, fps);
+        }
+        else if (arg == "--no-pacing") {
+            realtime = false;
+        }
+        else {
+            throw std::runtime_error("Unknown or incomplete argument: " + arg);
+        }
+    }
+
+    if (!source) {
+        // default: first camera, without one at least something to process
+        try {
+            source = std::make_unique<DeviceSource>(0);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << ", using synthetic source\n";
+            source = std::make_unique<SyntheticSource>(640, 480, 30.0);
+        }
+    }
+    source->realtime = realtime;
+    return source;
+}
+
+//
+// DeviceSource
+//
+
+DeviceSource::DeviceSource(const int index) : index(index), capture(index, cv::CAP_ANY)
+{
+    if (!capture.isOpened())
+        throw std::runtime_error("Can not open camera " + std::to_string(index));
+}
+
+bool DeviceSource::read(cv::Mat& frame)
+{
+    // grab() returns when the driver has a new frame, retrieve() decodes it
+    if (!capture.grab())
+        return false;
+    const double device_ms = capture.get(cv::CAP_PROP_POS_MSEC);
+    stamp(device_ms > 0.0 ? device_ms : -1.0);
+    return capture.retrieve(frame);
+}
+
+cv::Size DeviceSource::size(void) const
+{
+    return { (int)capture.get(cv::CAP_PROP_FRAME_WIDTH), (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT) };
+}
+
+double DeviceSource::fps(void) const
+{
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    return fps > 0.0 ? fps : 30.0;
+}
+
+bool DeviceSource::request_raw_yuyv(void)
+{
+    capture.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+    capture.set(cv::CAP_PROP_CONVERT_RGB, 0);
+    return capture.get(cv::CAP_PROP_CONVERT_RGB) == 0;
+}
+
+//
+// VideoFileSource
+//
+
+VideoFileSource::VideoFileSource(const std::filesystem::path& path) : path(path), capture(path.string())
+{
+    if (!capture.isOpened())
+        throw std::runtime_error("Can not open video: " + path.string());
+}
+
+bool VideoFileSource::read(cv::Mat& frame)
+{
+    pace();
+    if (!capture.grab()) {
+        // end of file -> from the beginning
+        capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+        if (!capture.grab())
+            return false;
+    }
+    stamp(capture.get(cv::CAP_PROP_POS_MSEC));     // position in the file
+    return capture.retrieve(frame);
+}
+
+cv::Size VideoFileSource::size(void) const
+{
+    return { (int)capture.get(cv::CAP_PROP_FRAME_WIDTH), (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT) };
+}
+
+double VideoFileSource::fps(void) const
+{
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    return fps > 0.0 ? fps : 30.0;
+}
+
+//
+// ImageSequenceSource
+//
+
+ImageSequenceSource::ImageSequenceSource(const std::filesystem::path& directory, const double fps) : directory(directory), rate(fps)
+{
+    if (!std::filesystem::is_directory(directory))
+        throw std::runtime_error("Not a directory: " + directory.string());
+
+    for (auto const& entry : std::filesystem::directory_iterator(directory))
+        if (entry.is_regular_file() && cv::haveImageReader(entry.path().string()))
+            files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+    if (files.empty())
+        throw std::runtime_error("No images in: " + directory.string());
+
+    first_size = cv::imread(files.front().string(), cv::IMREAD_COLOR).size();
+}
+
+bool ImageSequenceSource::read(cv::Mat& frame)
+{
+    pace();
+    stamp();
+    // unreadable files are skipped, at most one round
+    for (size_t tries = 0; tries < files.size(); tries++) {
+        cv::Mat image = cv::imread(files[next].string(), cv::IMREAD_COLOR);
+        next = (next + 1) % files.size();
+        if (!image.empty()) {
+            image.copyTo(frame);
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// SyntheticSource
+//
+
+SyntheticSource::SyntheticSource(const int width, const int height, const double fps) : rate(fps)
+{
+    // dark blue-grey gradient, nothing in it passes the colour detection
+    background.create(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++) {
+        cv::Vec3b* row = background.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < width; x++)
+            row[x] = cv::Vec3b(uchar(64 + 64 * y / height), uchar(48 + 32 * x / width), uchar(32));
+    }
+}
+
+bool SyntheticSource::read(cv::Mat& frame)
+{
+    pace();
+    stamp(1000.0 * double(frame_index) / rate);
+
+    // blob moves along a Lissajous curve, position depends on frame index only (deterministic)
+    const double t = double(frame_index++) / rate;
+    const cv::Size s = background.size();
+    const cv::Point center(int(s.width * (0.5 + 0.35 * std::cos(t * 0.9))), int(s.height * (0.5 + 0.35 * std::sin(t * 1.3))));
+    background.copyTo(frame);
+    cv::circle(frame, center, std::max(4, s.height / 12), cv::Scalar(60, 0, 255), cv::FILLED);    // red (HSV hue ~173)
+    return true;
+}
+
+std::string SyntheticSource::describe(void) const
+{
+    return "synthetic " + std::to_string(background.cols) + "x" + std::to_string(background.rows) + " @ " + std::to_string(int(rate)) + " FPS";
+}
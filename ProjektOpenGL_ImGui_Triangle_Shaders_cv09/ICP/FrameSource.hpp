@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// when a frame was captured: monotonic time right after the frame arrived (before decoding / copying)
+// and device timestamp (CAP_PROP_POS_MSEC of the backend), device_ms < 0 if the backend has none
+struct FrameTimestamp {
+    std::chrono::steady_clock::time_point captured{};
+    double device_ms = -1.0;
+};
+
+// Source of camera frames for the capture thread (BGR, or raw YUYV from a device that supports it).
+// Implementations: live device, video file, directory of images and a deterministic synthetic generator,
+// so capture / detection / encoding can run without a camera.
+// File and synthetic sources are paced to their frame rate when realtime is set, otherwise
+// they deliver frames as fast as they are read (benchmarks).
+// Devices and video files are read by blocking grab() (waits for the next frame, timestamp is taken
+// as soon as it returns) followed by retrieve() (decoding / colour conversion).
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // next frame into frame (buffer reused if size and type match), waits for the frame time
+    // returns false if no frame is available (device error, end of data)
+    virtual bool read(cv::Mat& frame) = 0;
+    const FrameTimestamp& timestamp(void) const { return last_timestamp; }     // of the last read() frame
+
+    virtual std::string describe(void) const = 0;
+    virtual cv::Size size(void) const = 0;
+    virtual double fps(void) const = 0;
+
+    // devices only: ask for frames without colour conversion, true if the device delivers them
+    virtual bool request_raw_yuyv(void) { return false; }
+
+    bool realtime = true;
+
+    // from command line:
+    //   --camera N           device N (default: device 0, synthetic 640x480@30 if there is none)
+    //   --video PATH         video file, loops
+    //   --images DIR         images of a directory in name order, loops
+    //   --synthetic WxH@FPS  generated frames with moving red blob, e.g. 640x480@30
+    //   --no-pacing          file and synthetic sources run as fast as possible
+    // throws std::runtime_error on unknown arguments or when the source can not be opened
+    static std::unique_ptr<FrameSource> from_args(int argc, char* argv[]);
+
+    // one frame period, e.g. to wait before retrying a failed read()
+    std::chrono::steady_clock::duration frame_period(void) const;
+
+protected:
+    void pace(void);        // sleep until next frame time (if realtime)
+    void stamp(const double device_ms = -1.0);      // frame arrived now
+
+private:
+    std::chrono::steady_clock::time_point next_frame{};
+    FrameTimestamp last_timestamp;
+};
+
+class DeviceSource : public FrameSource {
+public:
+    explicit DeviceSource(const int index);
+    bool read(cv::Mat& frame) override;     // paced by device (grab() blocks)
+    std::string describe(void) const override { return "camera " + std::to_string(index); }
+    cv::Size size(void) const override;
+    double fps(void) const override;
+    bool request_raw_yuyv(void) override;
+
+private:
+    int index;
+    mutable cv::VideoCapture capture;       // get() is not const
+};
+
+class VideoFileSource : public FrameSource {
+public:
+    explicit VideoFileSource(const std::filesystem::path& path);
+    bool read(cv::Mat& frame) override;
+    std::string describe(void) const override { return "video " + path.string(); }
+    cv::Size size(void) const override;
+    double fps(void) const override;
+
+private:
+    std::filesystem::path path;
+    mutable cv::VideoCapture capture;
+};
+
+class ImageSequenceSource : public FrameSource {
+public:
+    ImageSequenceSource(const std::filesystem::path& directory, const double fps = 30.0);
+    bool read(cv::Mat& frame) override;
+    std::string describe(void) const override { return "images " + directory.string() + " (" + std::to_string(files.size()) + ")"; }
+    cv::Size size(void) const override { return first_size; }
+    double fps(void) const override { return rate; }
+
+private:
+    std::filesystem::path directory;
+    std::vector<std::filesystem::path> files;
+    size_t next = 0;
+    cv::Size first_size;
+    double rate;
+};
+
+class SyntheticSource : public FrameSource {
+public:
+    SyntheticSource(const int width, const int height, const double fps);
+    bool read(cv::Mat& frame) override;
+    std::string describe(void) const override;
+    cv::Size size(void) const override { return background.size(); }
+    double fps(void) const override { return rate; }
+
+private:
+    cv::Mat background;             // static gradient, generated once
+    double rate;
+    unsigned long long frame_index = 0;
+};
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "GLState.hpp"
+#include "GBuffer.hpp"
+
+void GBuffer::resize(const int new_width, const int new_height)
+{
+    if ((new_width == width && new_height == height && FBO != 0) || new_width <= 0 || new_height <= 0)
+        return;     // unchanged or minimized window
+
+    // immutable storage can not be resized -> new textures
+    clear();
+    width = new_width;
+    height = new_height;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &albedo);
+    glTextureStorage2D(albedo, 1, GL_RGBA8, width, height);
+    glCreateTextures(GL_TEXTURE_2D, 1, &normal);
+    glTextureStorage2D(normal, 1, GL_RGBA16F, width, height);
+    glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+    glTextureStorage2D(depth, 1, GL_DEPTH24_STENCIL8, width, height);
+
+    // read by texelFetch only, but texture must be complete
+    for (GLuint tex : { albedo, normal, depth }) {
+        glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    glCreateFramebuffers(1, &FBO);
+    glNamedFramebufferTexture(FBO, GL_COLOR_ATTACHMENT0, albedo, 0);
+    glNamedFramebufferTexture(FBO, GL_COLOR_ATTACHMENT1, normal, 0);
+    glNamedFramebufferTexture(FBO, GL_DEPTH_STENCIL_ATTACHMENT, depth, 0);
+    GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(FBO, 2, draw_buffers);
+
+    if (glCheckNamedFramebufferStatus(FBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        throw std::runtime_error("G-buffer framebuffer incomplete.");
+
+    glCreateVertexArrays(1, &empty_VAO);
+
+    std::cout << "G-buffer: " << width << "x" << height << '\n';
+}
+
+void GBuffer::bind(void)
+{
+    gl_state.bindFramebuffer(FBO);
+
+    const GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat far_depth = 1.0f;
+    glClearNamedFramebufferfv(FBO, GL_COLOR, 0, zero);
+    glClearNamedFramebufferfv(FBO, GL_COLOR, 1, zero);
+    glClearNamedFramebufferfv(FBO, GL_DEPTH, 0, &far_depth);     // respects depth mask
+}
+
+void GBuffer::bind_textures(void)
+{
+    gl_state.bindTexture(4, GL_TEXTURE_2D, albedo);
+    gl_state.bindTexture(5, GL_TEXTURE_2D, normal);
+    gl_state.bindTexture(6, GL_TEXTURE_2D, depth);
+}
+
+void GBuffer::draw_fullscreen(void)
+{
+    gl_state.bindVertexArray(empty_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void GBuffer::blit_depth(const GLuint target_framebuffer)
+{
+    glBlitNamedFramebuffer(FBO, target_framebuffer, 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void GBuffer::clear(void)
+{
+    // cached bindings must not outlive the objects
+    gl_state.bindFramebuffer(0);
+    gl_state.bindVertexArray(0);
+    for (GLuint unit : { 4u, 5u, 6u })
+        gl_state.bindTexture(unit, GL_TEXTURE_2D, 0);
+
+    glDeleteFramebuffers(1, &FBO);
+    GLuint textures[] = { albedo, normal, depth };
+    glDeleteTextures(3, textures);
+    glDeleteVertexArrays(1, &empty_VAO);
+
+    FBO = albedo = normal = depth = empty_VAO = 0;
+    width = height = 0;
+}
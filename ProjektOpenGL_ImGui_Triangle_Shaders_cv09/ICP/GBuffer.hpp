@@ -0,0 +1,26 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Render targets of deferred path:
+//   albedo  GL_RGBA8      color attachment 0, texture unit 4
+//   normal  GL_RGBA16F    color attachment 1, texture unit 5 (world space)
+//   depth   GL_DEPTH24_STENCIL8                 texture unit 6
+// World position is reconstructed from depth in lighting pass (lighting.frag, FEATURE_DEFERRED).
+// Depth format matches default framebuffer, so it can be blitted there for the forward (transparent) pass.
+class GBuffer {
+public:
+    void resize(const int width, const int height);     // (re)create attachments when framebuffer size changed
+
+    void bind(void);                // render target of G-buffer pass, cleared
+    void bind_textures(void);       // inputs of lighting pass
+    void draw_fullscreen(void);     // fullscreen triangle (deferred.vert), program must be active
+    void blit_depth(const GLuint target_framebuffer);
+
+    void clear(void);
+
+private:
+    int width = 0, height = 0;
+    GLuint FBO{ 0 }, albedo{ 0 }, normal{ 0 }, depth{ 0 };
+    GLuint empty_VAO{ 0 };          // core profile can not draw without VAO
+};
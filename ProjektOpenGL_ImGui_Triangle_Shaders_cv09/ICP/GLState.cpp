@@ -0,0 +1,140 @@
+#include "GLState.hpp"
+
+GLState gl_state;
+
+bool GLState::changed(GLuint& cached, const GLuint value)
+{
+    if (cached == value) {
+        skipped++;
+        return false;
+    }
+    cached = value;
+    issued++;
+    return true;
+}
+
+void GLState::useProgram(const GLuint id)
+{
+    if (changed(program, id))
+        glUseProgram(id);
+}
+
+void GLState::bindVertexArray(const GLuint id)
+{
+    if (changed(vao, id)) {
+        glBindVertexArray(id);
+        // element array binding is part of VAO state
+        buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void GLState::bindBuffer(const GLenum target, const GLuint id)
+{
+    auto it = buffers.try_emplace(target, UNKNOWN).first;
+    if (changed(it->second, id))
+        glBindBuffer(target, id);
+}
+
+void GLState::bindBufferBase(const GLenum target, const GLuint index, const GLuint id)
+{
+    auto it = indexed_buffers.try_emplace({ target, index }, UNKNOWN).first;
+    if (changed(it->second, id)) {
+        glBindBufferBase(target, index, id);
+        // glBindBufferBase binds to the generic target too
+        buffers[target] = id;
+    }
+}
+
+void GLState::bindTexture(const GLuint unit, const GLenum target, const GLuint id)
+{
+    auto it = textures.try_emplace({ unit, target }, UNKNOWN).first;
+    if (it->second == id) {
+        skipped++;
+        return;
+    }
+    if (changed(active_unit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    changed(it->second, id);
+    glBindTexture(target, id);
+}
+
+void GLState::bindFramebuffer(const GLuint id)
+{
+    if (changed(framebuffer, id))
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+}
+
+void GLState::enable(const GLenum cap, const bool on)
+{
+    auto it = caps.try_emplace(cap, UNKNOWN).first;
+    if (changed(it->second, on)) {
+        if (on)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+}
+
+void GLState::depthMask(const bool on)
+{
+    if (changed(depth_mask, on))
+        glDepthMask(on ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::colorMask(const bool on)
+{
+    if (changed(color_mask, on)) {
+        GLboolean b = on ? GL_TRUE : GL_FALSE;
+        glColorMask(b, b, b, b);
+    }
+}
+
+void GLState::depthFunc(const GLenum func)
+{
+    if (changed(depth_func, func))
+        glDepthFunc(func);
+}
+
+void GLState::blendFunc(const GLenum sfactor, const GLenum dfactor)
+{
+    if (blend_src == sfactor && blend_dst == dfactor) {
+        skipped++;
+        return;
+    }
+    blend_src = sfactor;
+    blend_dst = dfactor;
+    issued++;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void GLState::polygonOffset(const float factor, const float units)
+{
+    if (polygon_offset_known && offset_factor == factor && offset_units == units) {
+        skipped++;
+        return;
+    }
+    polygon_offset_known = true;
+    offset_factor = factor;
+    offset_units = units;
+    issued++;
+    glPolygonOffset(factor, units);
+}
+
+void GLState::invalidate(void)
+{
+    program = vao = active_unit = framebuffer = UNKNOWN;
+    buffers.clear();
+    indexed_buffers.clear();
+    textures.clear();
+    caps.clear();
+    depth_mask = color_mask = depth_func = UNKNOWN;
+    blend_src = blend_dst = UNKNOWN;
+    polygon_offset_known = false;
+}
+
+void GLState::end_frame(void)
+{
+    last_frame_issued = issued;
+    last_frame_skipped = skipped;
+    issued = skipped = 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <utility>
+
+#include <GL/glew.h>
+
+// Thin cache of OpenGL binding/enable state.
+// All rendering code changes state through it, calls that would not change anything are skipped.
+// Code that changes GL state behind its back (e.g. external library) must call invalidate() afterwards.
+// ImGui OpenGL3 backend restores everything it touches, so it does not need it.
+class GLState {
+public:
+    void useProgram(const GLuint program);
+    void bindVertexArray(const GLuint vao);
+    void bindBuffer(const GLenum target, const GLuint buffer);
+    void bindBufferBase(const GLenum target, const GLuint index, const GLuint buffer);    // UBO, SSBO, ...
+    void bindTexture(const GLuint unit, const GLenum target, const GLuint texture);       // unit = 0, 1, ... (not GL_TEXTURE0)
+    void bindFramebuffer(const GLuint framebuffer);                                       // GL_FRAMEBUFFER (draw + read)
+
+    void enable(const GLenum cap, const bool on);   // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, ...
+    void depthMask(const bool on);
+    void colorMask(const bool on);                  // all four channels
+    void depthFunc(const GLenum func);
+    void blendFunc(const GLenum sfactor, const GLenum dfactor);
+    void polygonOffset(const float factor, const float units);
+
+    void invalidate(void);      // forget everything, next call of each kind is always issued
+
+    // statistics: GL calls issued vs. skipped as redundant
+    void end_frame(void);       // moves current counters to last_frame_* and resets them
+    unsigned long issued = 0, skipped = 0;
+    unsigned long last_frame_issued = 0, last_frame_skipped = 0;
+
+private:
+    static constexpr GLuint UNKNOWN = ~0u;
+
+    bool changed(GLuint& cached, const GLuint value);   // update cache, count the call
+
+    GLuint program = UNKNOWN;
+    GLuint vao = UNKNOWN;
+    GLuint active_unit = UNKNOWN;
+    GLuint framebuffer = UNKNOWN;
+    std::map<GLenum, GLuint> buffers;                                   // target -> buffer
+    std::map<std::pair<GLenum, GLuint>, GLuint> indexed_buffers;        // (target, index) -> buffer
+    std::map<std::pair<GLuint, GLenum>, GLuint> textures;               // (unit, target) -> texture
+    std::map<GLenum, GLuint> caps;                                      // cap -> enabled
+    GLuint depth_mask = UNKNOWN;
+    GLuint color_mask = UNKNOWN;
+    GLuint depth_func = UNKNOWN;
+    GLuint blend_src = UNKNOWN, blend_dst = UNKNOWN;
+    bool polygon_offset_known = false;
+    float offset_factor = 0.0f, offset_units = 0.0f;
+};
+
+extern GLState gl_state;
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "GpuColorDetect.hpp"
+#include "GLState.hpp"
+
+void GpuColorDetector::init(const ColorClassifier& classifier)
+{
+    if (!supported())
+        throw std::runtime_error("GpuColorDetector: compute shaders not supported");
+
+    program = ShaderProgram("resources/color_detect.comp");
+
+    // table packed four cells per uint (GLSL has no 8-bit buffer type in core)
+    const std::vector<uint8_t>& table = classifier.table();
+    std::vector<GLuint> packed((table.size() + 3) / 4, 0);
+    std::memcpy(packed.data(), table.data(), table.size());     // little endian: cell i in byte i % 4
+    glCreateBuffers(1, &table_buffer);
+    glNamedBufferStorage(table_buffer, packed.size() * sizeof(GLuint), packed.data(), 0);
+    table_bits = classifier.table_bits();
+
+    // read back through coherent mapping, cleared through it as well (slot is free = GPU is done with it)
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(SLOTS, slot_buffer);
+    for (int i = 0; i < SLOTS; i++) {
+        glNamedBufferStorage(slot_buffer[i], sizeof(Counts), nullptr, flags);
+        slot_data[i] = static_cast<Counts*>(glMapNamedBufferRange(slot_buffer[i], 0, sizeof(Counts), flags));
+    }
+}
+
+bool GpuColorDetector::detect(const CameraTexture& texture, const ColorClassifier& classifier)
+{
+    if (texture.getID() == 0)
+        return false;
+    if (program.getID() == 0)
+        init(classifier);
+
+    int index = -1;
+    for (int i = 0; i < SLOTS; i++)
+        if (slot_fence[i] == nullptr) {
+            index = i;
+            break;
+        }
+    if (index < 0) {
+        skipped++;
+        return false;
+    }
+
+    Counts& counts = *slot_data[index];
+    for (int c = 0; c < MAX_CLASSES; c++) {
+        counts.count[c] = 0;
+        counts.x0[c] = counts.y0[c] = 0xFFFFFFFFu;
+        counts.x1[c] = counts.y1[c] = 0;
+    }
+
+    program.activate();
+    program.setUniform("bits", table_bits);
+    gl_state.bindTexture(0, GL_TEXTURE_2D, texture.getID());
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, table_buffer);
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, slot_buffer[index]);
+
+    timer.begin();
+    glDispatchCompute((texture.width() + 15) / 16, (texture.height() + 15) / 16, 1);
+    timer.end();
+    // shader writes visible through the mapping once the fence is signalled
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    slot_fence[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();      // fence must reach the GPU, otherwise it is never signalled while only polled
+
+    slot_update[index] = updates;
+    Result& result = slot_result[index];
+    result.frame = texture.uploaded.load();
+    result.timestamp = texture.timestamp();
+    result.frame_size = cv::Size(texture.width(), texture.height());
+    dispatched++;
+    return true;
+}
+
+bool GpuColorDetector::update(void)
+{
+    updates++;
+
+    // newest finished slot wins, older finished ones are just freed
+    int newest = -1;
+    for (int i = 0; i < SLOTS; i++) {
+        if (slot_fence[i] == nullptr || glClientWaitSync(slot_fence[i], 0, 0) == GL_TIMEOUT_EXPIRED)
+            continue;
+        glDeleteSync(slot_fence[i]);
+        slot_fence[i] = nullptr;
+        if (slot_result[i].frame > last.frame && (newest < 0 || slot_result[i].frame > slot_result[newest].frame))
+            newest = i;
+    }
+    if (newest < 0)
+        return false;
+
+    const Counts& counts = *slot_data[newest];
+    last = slot_result[newest];
+    last.read = std::chrono::steady_clock::now();
+    last.latency_frames = int(updates - slot_update[newest]);
+    last.detection = ColorDetection();
+    for (int c = 0; c < MAX_CLASSES; c++) {
+        last.detection.pixels[c] = int(counts.count[c]);
+        if (counts.count[c] != 0) {
+            last.detection.boxes[c].add(int(counts.x0[c]), int(counts.y0[c]));
+            last.detection.boxes[c].add(int(counts.x1[c]), int(counts.y1[c]));
+        }
+    }
+    return true;
+}
+
+void GpuColorDetector::clear(void)
+{
+    for (int i = 0; i < SLOTS; i++) {
+        if (slot_fence[i])
+            glDeleteSync(slot_fence[i]);
+        slot_fence[i] = nullptr;
+        if (slot_buffer[i]) {
+            glUnmapNamedBuffer(slot_buffer[i]);
+            glDeleteBuffers(1, &slot_buffer[i]);
+        }
+        slot_buffer[i] = 0;
+        slot_data[i] = nullptr;
+    }
+    if (table_buffer) {
+        gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, 0);    // cached bindings must not outlive the buffers
+        gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, 0);
+        glDeleteBuffers(1, &table_buffer);
+    }
+    table_buffer = 0;
+    timer.clear();
+    program.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "ShaderProgram.hpp"
+#include "CameraTexture.hpp"
+#include "ColorDetect.hpp"
+#include "GpuTimer.h"
+
+// Colour detection of the camera texture on the GPU (compute shader resources/color_detect.comp),
+// i.e. of the frame that is already uploaded for the preview instead of the CPU copy.
+// Same lookup table as ColorClassifier (SSBO binding 4, four cells per uint), one invocation per texel,
+// counts and bounding boxes of each 16x16 workgroup in shared memory, merged by one atomic per class and workgroup.
+// Results go to one of SLOTS small persistently mapped buffers (SSBO binding 5), fenced after the dispatch and
+// read by a later update() once the fence is signalled (usually the next frame), so the render thread never waits.
+// YUYV frames are classified after the GPU colour conversion, which rounds a little differently than OpenCV's.
+// Render thread only.
+class GpuColorDetector {
+public:
+    static constexpr int SLOTS = 3;
+
+    struct Result {
+        unsigned long long frame = 0;           // camera texture upload number
+        FrameTimestamp timestamp;               // of the classified frame
+        std::chrono::steady_clock::time_point read{};   // result read back
+        int latency_frames = 0;                 // update() calls between dispatch and read back
+        cv::Size frame_size;
+        ColorDetection detection;
+    };
+
+    GpuColorDetector(void) = default;
+    ~GpuColorDetector() = default;      // GL objects are released by clear()
+
+    GpuColorDetector(const GpuColorDetector&) = delete;
+    GpuColorDetector& operator=(const GpuColorDetector&) = delete;
+
+    static bool supported(void) { return GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_buffer_storage; }
+
+    // after camera texture changed: classify it, false = all slots still in flight (frame skipped)
+    // (first call uploads the table of classifier and builds the program)
+    bool detect(const CameraTexture& texture, const ColorClassifier& classifier);
+    // once per frame: collect finished slots, true if a newer result arrived
+    bool update(void);
+
+    const Result& result(void) const { return last; }
+    double gpu_ms(void) const { return timer.ms(); }    // dispatch, smoothed
+
+    unsigned long dispatched = 0;
+    unsigned long skipped = 0;      // no free slot
+
+    void clear(void);
+
+private:
+    static constexpr int MAX_CLASSES = ColorClassifier::MAX_CLASSES;
+
+    // same layout as buffer Result in color_detect.comp (std430)
+    struct Counts {
+        GLuint count[MAX_CLASSES];
+        GLuint x0[MAX_CLASSES], y0[MAX_CLASSES];
+        GLuint x1[MAX_CLASSES], y1[MAX_CLASSES];
+    };
+
+    void init(const ColorClassifier& classifier);
+
+    ShaderProgram program;
+    GLuint table_buffer = 0;
+    int table_bits = 0;
+    GpuTimer timer;
+
+    GLuint slot_buffer[SLOTS]{};
+    Counts* slot_data[SLOTS]{};
+    GLsync slot_fence[SLOTS]{};         // nullptr = slot free
+    unsigned long long slot_update[SLOTS]{};    // update() count at dispatch
+    Result slot_result[SLOTS];          // everything but detection, filled at dispatch
+    unsigned long long updates = 0;
+
+    Result last;
+};
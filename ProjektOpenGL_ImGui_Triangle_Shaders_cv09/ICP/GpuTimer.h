@@ -0,0 +1,48 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Measures GPU time of commands between begin() and end() (GL_TIME_ELAPSED query).
+// Results are read a few frames later from a ring of queries, so measuring never stalls the pipeline.
+class GpuTimer {
+public:
+    void begin(void) {
+        if (queries[0] == 0)
+            glGenQueries(N, queries);
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void end(void) {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[current] = true;
+        current = (current + 1) % N;
+
+        // oldest query in the ring, i.e. the one that will be reused next
+        if (issued[current]) {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &ns);
+                // exponential smoothing, raw value jumps a lot
+                last_ms = (last_ms == 0.0) ? ns * 1e-6 : 0.9 * last_ms + 0.1 * (ns * 1e-6);
+            }
+            issued[current] = false;
+        }
+    }
+
+    double ms(void) const { return last_ms; }
+
+    void clear(void) {
+        if (queries[0] != 0)
+            glDeleteQueries(N, queries);
+        queries[0] = 0;
+    }
+
+private:
+    static constexpr int N = 4;     // frames in flight
+    GLuint queries[N]{};
+    bool issued[N]{};
+    int current = 0;
+    double last_ms = 0.0;
+};
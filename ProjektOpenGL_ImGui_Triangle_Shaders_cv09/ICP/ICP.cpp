@@ -15,8 +15,14 @@ App app;
 
 
 
-int main()
+int main(int argc, char* argv[])
 {
-    if (app.init())
+    // colour detection kernels on 1080p / 4K frames, no window
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-color") {
+        color_benchmark(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    if (app.init(argc, argv))
         return app.run();
 }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Rolling histogram of latencies [ms] over the last WINDOW samples, fixed bins of BIN_MS
+// (last bin collects everything longer). Percentiles are read from bin counts, so they cost
+// one pass over the bins and nothing is sorted or allocated after construction.
+class LatencyHistogram {
+public:
+    static constexpr int WINDOW = 600;          // samples (~10 s of 60 FPS)
+    static constexpr int BINS = 200;
+    static constexpr float BIN_MS = 1.0f;       // -> 0..200 ms
+
+    LatencyHistogram(void) : bins(BINS, 0), samples(WINDOW, 0) {}
+
+    void add(const double ms) {
+        if (count == WINDOW)
+            bins[samples[next]]--;      // oldest sample leaves the window
+        else
+            count++;
+        const int bin = std::clamp(int(ms / BIN_MS), 0, BINS - 1);
+        bins[bin]++;
+        samples[next] = bin;
+        next = (next + 1) % WINDOW;
+        last_ms = ms;
+    }
+
+    // upper edge of the bin containing percentile p (0..100), 0 if empty
+    float percentile(const float p) const {
+        if (count == 0)
+            return 0.0f;
+        const int rank = std::max(1, int(p / 100.0f * count + 0.5f));
+        int seen = 0;
+        for (int i = 0; i < BINS; i++) {
+            seen += int(bins[i]);
+            if (seen >= rank)
+                return (i + 1) * BIN_MS;
+        }
+        return BINS * BIN_MS;
+    }
+
+    int size(void) const { return count; }
+    double last(void) const { return last_ms; }
+    const std::vector<float>& histogram(void) const { return bins; }   // counts per bin (e.g. ImGui::PlotHistogram)
+
+private:
+    std::vector<float> bins;
+    std::vector<int> samples;       // bin of each sample in the window (ring)
+    int next = 0, count = 0;
+    double last_ms = 0.0;
+};
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "GLState.hpp"
+#include "LightClusters.hpp"
+
+Light Light::point(const glm::vec3& position, const float range, const glm::vec3& color)
+{
+    return { glm::vec4(position, range), glm::vec4(color, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, -2.0f), glm::vec4(-2.0f) };
+}
+
+Light Light::spot(const glm::vec3& position, const float range, const glm::vec3& color,
+    const glm::vec3& direction, const float inner_deg, const float outer_deg)
+{
+    return { glm::vec4(position, range), glm::vec4(color, 1.0f),
+        glm::vec4(glm::normalize(direction), glm::cos(glm::radians(inner_deg))),
+        glm::vec4(glm::cos(glm::radians(outer_deg)), 0.0f, 0.0f, 0.0f) };
+}
+
+void LightClusters::build_aabbs(void)
+{
+    aabbs.resize(size_t(grid_size.x) * grid_size.y * grid_size.z);
+
+    const float tan_y = std::tan(fovy * 0.5f);
+    const float tan_x = tan_y * aspect;
+
+    for (unsigned z = 0; z < grid_size.z; z++) {
+        // exponential slicing, same formula as in lighting.frag
+        float d0 = near_plane * std::pow(far_plane / near_plane, float(z) / grid_size.z);
+        float d1 = near_plane * std::pow(far_plane / near_plane, float(z + 1) / grid_size.z);
+
+        for (unsigned y = 0; y < grid_size.y; y++) {
+            float y0 = -1.0f + 2.0f * y / grid_size.y;
+            float y1 = -1.0f + 2.0f * (y + 1) / grid_size.y;
+
+            for (unsigned x = 0; x < grid_size.x; x++) {
+                float x0 = -1.0f + 2.0f * x / grid_size.x;
+                float x1 = -1.0f + 2.0f * (x + 1) / grid_size.x;
+
+                // tile corners on near and far plane of the slice (view space, camera looks to -Z)
+                AABB box{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+                for (float d : { d0, d1 })
+                    for (float nx : { x0, x1 })
+                        for (float ny : { y0, y1 }) {
+                            glm::vec3 p(nx * tan_x * d, ny * tan_y * d, -d);
+                            box.min = glm::min(box.min, p);
+                            box.max = glm::max(box.max, p);
+                        }
+                aabbs[x + grid_size.x * (y + grid_size.y * z)] = box;
+            }
+        }
+    }
+}
+
+void LightClusters::assign(const unsigned z_begin, const unsigned z_end, const std::vector<glm::vec4>& view_lights)
+{
+    std::vector<GLuint> candidates;
+    for (unsigned z = z_begin; z < z_end; z++) {
+        std::vector<GLuint>& out = slice_indices[z];
+        out.clear();
+
+        // lights overlapping depth range of the slice
+        const AABB& slice = aabbs[grid_size.x * grid_size.y * z];
+        candidates.clear();
+        for (GLuint i = 0; i < view_lights.size(); i++) {
+            float d = -view_lights[i].z, r = view_lights[i].w;
+            if (d + r >= -slice.max.z && d - r <= -slice.min.z)
+                candidates.push_back(i);
+        }
+
+        for (unsigned c = grid_size.x * grid_size.y * z; c < grid_size.x * grid_size.y * (z + 1); c++) {
+            GLuint offset = (GLuint)out.size();
+            for (GLuint i : candidates) {
+                // sphere x AABB: distance from center to closest point of the box
+                glm::vec3 center(view_lights[i]);
+                glm::vec3 closest = glm::clamp(center, aabbs[c].min, aabbs[c].max);
+                glm::vec3 diff = closest - center;
+                if (glm::dot(diff, diff) <= view_lights[i].w * view_lights[i].w)
+                    out.push_back(i);
+            }
+            clusters[c] = glm::uvec2(offset, (GLuint)out.size() - offset);   // offset is local to slice for now
+        }
+    }
+}
+
+void LightClusters::update(const glm::mat4& view_matrix, const float fovy, const float aspect, const float z_near, const float z_far)
+{
+    if (light_buffer == 0) {
+        glCreateBuffers(1, &light_buffer);
+        glCreateBuffers(1, &cluster_buffer);
+        glCreateBuffers(1, &index_buffer);
+    }
+
+    if (fovy != this->fovy || aspect != this->aspect || z_near != near_plane || z_far != far_plane) {
+        this->fovy = fovy;
+        this->aspect = aspect;
+        near_plane = z_near;
+        far_plane = z_far;
+        build_aabbs();
+    }
+
+    // lights to view space once, shared by all threads
+    std::vector<glm::vec4> view_lights(lights.size());
+    for (size_t i = 0; i < lights.size(); i++)
+        view_lights[i] = glm::vec4(glm::vec3(view_matrix * glm::vec4(glm::vec3(lights[i].position_range), 1.0f)), lights[i].position_range.w);
+
+    clusters.resize(aabbs.size());
+    slice_indices.resize(grid_size.z);
+
+    // depth slices are independent -> spread over pool (not worth it for a few lights)
+    if (pool && lights.size() >= 32)
+        pool->parallel_for(grid_size.z, [&](size_t z) { assign(unsigned(z), unsigned(z) + 1, view_lights); });
+    else
+        assign(0, grid_size.z, view_lights);
+
+    // concatenate slices, make offsets global
+    light_indices.clear();
+    for (unsigned z = 0; z < grid_size.z; z++) {
+        GLuint base = (GLuint)light_indices.size();
+        for (unsigned c = grid_size.x * grid_size.y * z; c < grid_size.x * grid_size.y * (z + 1); c++)
+            clusters[c].x += base;
+        light_indices.insert(light_indices.end(), slice_indices[z].begin(), slice_indices[z].end());
+    }
+
+    // sizes change every frame -> reallocate (orphan) whole buffers, at least one element so binding is valid
+    glNamedBufferData(light_buffer, std::max<size_t>(lights.size(), 1) * sizeof(Light), lights.empty() ? nullptr : lights.data(), GL_STREAM_DRAW);
+    glNamedBufferData(cluster_buffer, clusters.size() * sizeof(glm::uvec2), clusters.data(), GL_STREAM_DRAW);
+    glNamedBufferData(index_buffer, std::max<size_t>(light_indices.size(), 1) * sizeof(GLuint), light_indices.empty() ? nullptr : light_indices.data(), GL_STREAM_DRAW);
+}
+
+void LightClusters::bind(void)
+{
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, light_buffer);
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, cluster_buffer);
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, index_buffer);
+}
+
+void LightClusters::clear(void)
+{
+    GLuint buffers[] = { light_buffer, cluster_buffer, index_buffer };
+    glDeleteBuffers(3, buffers);
+    light_buffer = cluster_buffer = index_buffer = 0;
+    lights.clear();
+    aabbs.clear();
+    clusters.clear();
+    light_indices.clear();
+    slice_indices.clear();
+    fovy = aspect = near_plane = far_plane = 0.0f;
+}
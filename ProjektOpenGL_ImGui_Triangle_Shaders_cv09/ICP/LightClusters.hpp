@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ThreadPool.hpp"
+
+// one point or spot light, same layout as struct Light in lighting.frag (std430)
+struct Light {
+    glm::vec4 position_range;       // xyz = world position, w = range (no light beyond it)
+    glm::vec4 color;                // rgb = color * intensity
+    glm::vec4 direction_inner;      // spot: xyz = direction, w = cos(inner angle); point light: w = -2
+    glm::vec4 outer;                // spot: x = cos(outer angle)
+
+    static Light point(const glm::vec3& position, const float range, const glm::vec3& color);
+    static Light spot(const glm::vec3& position, const float range, const glm::vec3& color,
+        const glm::vec3& direction, const float inner_deg, const float outer_deg);
+};
+
+// Clustered forward lighting.
+// View frustum is divided into grid_x * grid_y screen tiles and grid_z exponential depth slices.
+// Every frame, lights are assigned to clusters they touch (CPU, slices spread over a ThreadPool if given)
+// and three SSBOs are uploaded: lights (binding 1), per-cluster (offset, count) (binding 2)
+// and light index list (binding 3). Fragment shader (FEATURE_CLUSTERED) shades only lights of its cluster.
+class LightClusters {
+public:
+    LightClusters(void) = default;
+    LightClusters(const unsigned grid_x, const unsigned grid_y, const unsigned grid_z, ThreadPool* pool = nullptr)
+        : grid_size(grid_x, grid_y, grid_z), pool(pool) {}
+
+    std::vector<Light> lights;      // world space, filled by application every frame
+
+    // assign lights to clusters for given camera and upload SSBOs
+    void update(const glm::mat4& view_matrix, const float fovy, const float aspect, const float z_near, const float z_far);
+    void bind(void);                // bind SSBOs to bindings 1, 2, 3
+
+    glm::uvec3 grid(void) const { return grid_size; }
+    glm::vec2 depth_range(void) const { return { near_plane, far_plane }; }
+    size_t assigned(void) const { return light_indices.size(); }   // total number of (cluster, light) pairs
+
+    void clear(void);
+
+private:
+    struct AABB { glm::vec3 min, max; };
+
+    void build_aabbs(void);     // view space bounding boxes of clusters, only when projection changes
+    void assign(const unsigned z_begin, const unsigned z_end, const std::vector<glm::vec4>& view_lights);
+
+    glm::uvec3 grid_size{ 16, 9, 24 };
+    ThreadPool* pool = nullptr;         // nullptr = everything on calling thread
+    float fovy = 0.0f, aspect = 0.0f, near_plane = 0.0f, far_plane = 0.0f;
+
+    std::vector<AABB> aabbs;
+    std::vector<glm::uvec2> clusters;                   // offset into light_indices, count
+    std::vector<GLuint> light_indices;
+    std::vector<std::vector<GLuint>> slice_indices;     // per depth slice, filled by worker threads, then concatenated
+
+    GLuint light_buffer{ 0 }, cluster_buffer{ 0 }, index_buffer{ 0 };
+};
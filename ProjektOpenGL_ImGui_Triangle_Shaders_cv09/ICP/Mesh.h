@@ -3,14 +3,16 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include "../include/stb_image.h" 
 
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
 #include "Vertex.h"
+#include "GLState.hpp"
 #include "ShaderProgram.hpp"
+#include "ShaderVariants.hpp"
+#include "TextureArray.hpp"
 
 class Mesh {
 public:
@@ -18,19 +20,19 @@ public:
     glm::vec3 orientation{};
     GLenum primitive_type = GL_TRIANGLES;
 
-    ShaderProgram& shader;
-
-    GLuint texture_id = 0;
+    TextureArray* texture_array = nullptr;  // diffuse texture = one layer of shared texture array
+    GLint texture_layer = -1;
+    glm::vec4 diffuse_color{ 1.0f };    // used when there is no texture
+    unsigned features = 0;              // material part of shader variant (FEATURE_TEXTURE, FEATURE_ALPHA)
 
     Mesh(GLenum primitive_type,
-        ShaderProgram& shader,
         const std::vector<Vertex>& vertices,
         const std::vector<GLuint>& indices,
         const glm::vec3& origin,
         const glm::vec3& orientation,
+        TextureArray* textures = nullptr,
         const std::string& texture_path = "")
         : primitive_type(primitive_type),
-        shader(shader),
         vertices(vertices),
         indices(indices),
         origin(origin),
@@ -41,12 +43,12 @@ public:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        gl_state.bindVertexArray(VAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        gl_state.bindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
         // Pozice (location = 0)
@@ -61,53 +63,55 @@ public:
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
         glEnableVertexAttribArray(2);
 
-        glBindVertexArray(0);
-
-        // 2. Načti texturu, pokud je uvedena
-        if (!texture_path.empty()) {
-            glGenTextures(1, &texture_id);
-            glBindTexture(GL_TEXTURE_2D, texture_id);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            int width, height, nrChannels;
-            stbi_set_flip_vertically_on_load(true);
-            unsigned char* data = stbi_load(texture_path.c_str(), &width, &height, &nrChannels, 0);
-            if (data) {
-                GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-                glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
-            }
-            else {
-                std::cerr << "Failed to load texture: " << texture_path << std::endl;
+        gl_state.bindVertexArray(0);
+
+        // 2. Načti texturu, pokud je uvedena (jako další vrstvu texture array)
+        if (textures && !texture_path.empty()) {
+            int nrChannels = 0;
+            texture_layer = textures->add(texture_path, nrChannels);
+            if (texture_layer >= 0) {
+                texture_array = textures;
+                features |= FEATURE_TEXTURE;
+                if (nrChannels == 4)
+                    features |= FEATURE_ALPHA;
             }
-            stbi_image_free(data);
         }
     }
 
-    void draw(glm::vec3 const& offset = glm::vec3(0.0f), glm::vec3 const& rotation = glm::vec3(0.0f)) {
-        if (texture_id != 0) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texture_id);
-            shader.setUniform("texture_diffuse", 0); // předává se do fragment shaderu
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+    const std::vector<GLuint>& getIndices() const { return indices; }
+
+    // shader = active variant of lighting shader, selected by caller according to features
+    void draw(ShaderProgram& shader, glm::vec3 const& offset = glm::vec3(0.0f), glm::vec3 const& rotation = glm::vec3(0.0f)) {
+        if (features & FEATURE_TEXTURE) {
+            // sampler texture_diffuse has layout(binding = 0) in shader
+            texture_array->bind();
+            shader.setUniform("uLayer", texture_layer);
         }
+        else {
+            shader.setUniform("materialColor", diffuse_color);
+        }
+
+        draw_geometry();
+    }
 
-        glBindVertexArray(VAO);
+    // geometry only, no material (depth pre-pass)
+    void draw_geometry(void) {
+        // no unbind after draw, the next draw binds what it needs (state cache skips repeated binds)
+        gl_state.bindVertexArray(VAO);
         glDrawElements(primitive_type, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     }
 
 
 
 	void clear(void) {
-        texture_id = 0;
+        texture_array = nullptr;
+        texture_layer = -1;
         primitive_type = GL_POINT;
         // TODO: clear rest of the member variables to safe default
         
         // TODO: delete all allocations 
+        gl_state.bindVertexArray(0);    // cached VAO name must not outlive the object
         glDeleteBuffers(1, &VBO);
         glDeleteBuffers(1, &EBO);
         glDeleteVertexArrays(1, &VAO);
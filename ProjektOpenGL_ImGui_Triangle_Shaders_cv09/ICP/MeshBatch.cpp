@@ -0,0 +1,122 @@
+#include <cstddef>
+
+#include "GLState.hpp"
+#include "MeshBatch.hpp"
+#include "Model.h"
+
+unsigned MeshBatch::add_mesh(const std::vector<Vertex>& mesh_vertices, const std::vector<GLuint>& mesh_indices)
+{
+    meshes.push_back({ (GLuint)indices.size(), (GLuint)mesh_indices.size(), (GLint)vertices.size() });
+    vertices.insert(vertices.end(), mesh_vertices.begin(), mesh_vertices.end());
+    indices.insert(indices.end(), mesh_indices.begin(), mesh_indices.end());
+    return (unsigned)meshes.size() - 1;
+}
+
+unsigned MeshBatch::add_instance(const unsigned mesh, const GLint layer)
+{
+    if (VAO != 0)
+        throw std::runtime_error("MeshBatch: instances can not be added after build.");
+
+    instance_mesh.push_back(mesh);
+    instances.push_back({ glm::mat4(1.0f), glm::mat3(1.0f), layer });
+    return (unsigned)instance_mesh.size() - 1;
+}
+
+void MeshBatch::build(void)
+{
+    // instances of one mesh must be contiguous: draw command i uses instances [baseInstance, baseInstance + instanceCount)
+    std::vector<InstanceData> sorted;
+    instance_slot.assign(instances.size(), 0);
+    for (unsigned m = 0; m < meshes.size(); m++) {
+        DrawElementsIndirectCommand cmd{ meshes[m].index_count, 0, meshes[m].first_index, meshes[m].base_vertex, (GLuint)sorted.size() };
+        for (size_t i = 0; i < instances.size(); i++) {
+            if (instance_mesh[i] == m) {
+                instance_slot[i] = sorted.size();
+                sorted.push_back(instances[i]);
+                cmd.instanceCount++;
+            }
+        }
+        if (cmd.instanceCount > 0)
+            commands.push_back(cmd);
+    }
+    instances = std::move(sorted);
+
+    glCreateBuffers(1, &VBO);
+    glNamedBufferStorage(VBO, vertices.size() * sizeof(Vertex), vertices.data(), 0);
+    glCreateBuffers(1, &EBO);
+    glNamedBufferStorage(EBO, indices.size() * sizeof(GLuint), indices.data(), 0);
+    glCreateBuffers(1, &instance_buffer);
+    glNamedBufferStorage(instance_buffer, instances.size() * sizeof(InstanceData), instances.data(), GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &indirect_buffer);
+    glNamedBufferStorage(indirect_buffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), 0);
+
+    // DSA: VAO is set up without binding anything
+    glCreateVertexArrays(1, &VAO);
+    glVertexArrayElementBuffer(VAO, EBO);
+
+    // binding 0 = per vertex (same layout as Mesh)
+    glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(Vertex));
+    glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+    glVertexArrayAttribFormat(VAO, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+    glVertexArrayAttribFormat(VAO, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+    for (GLuint a = 0; a <= 2; a++) {
+        glVertexArrayAttribBinding(VAO, a, 0);
+        glEnableVertexArrayAttrib(VAO, a);
+    }
+
+    // binding 1 = per instance
+    glVertexArrayVertexBuffer(VAO, 1, instance_buffer, 0, sizeof(InstanceData));
+    glVertexArrayBindingDivisor(VAO, 1, 1);
+    for (GLuint c = 0; c < 4; c++)
+        glVertexArrayAttribFormat(VAO, 3 + c, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, model) + c * sizeof(glm::vec4));
+    for (GLuint c = 0; c < 3; c++)
+        glVertexArrayAttribFormat(VAO, 7 + c, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, normal) + c * sizeof(glm::vec3));
+    glVertexArrayAttribIFormat(VAO, 10, 1, GL_INT, offsetof(InstanceData, layer));
+    for (GLuint a = 3; a <= 10; a++) {
+        glVertexArrayAttribBinding(VAO, a, 1);
+        glEnableVertexArrayAttrib(VAO, a);
+    }
+
+    instances_dirty = false;
+}
+
+void MeshBatch::set_transform(const unsigned instance, const glm::mat4& model_matrix)
+{
+    InstanceData& inst = instances[instance_slot.at(instance)];
+    inst.model = model_matrix;
+    inst.normal = normal_matrix(model_matrix);
+    instances_dirty = true;
+}
+
+void MeshBatch::draw(void)
+{
+    if (commands.empty())
+        return;
+
+    if (instances_dirty) {
+        glNamedBufferSubData(instance_buffer, 0, instances.size() * sizeof(InstanceData), instances.data());
+        instances_dirty = false;
+    }
+
+    gl_state.bindVertexArray(VAO);
+    gl_state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+}
+
+void MeshBatch::clear(void)
+{
+    gl_state.bindVertexArray(0);
+    gl_state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = { VBO, EBO, instance_buffer, indirect_buffer };
+    glDeleteBuffers(4, buffers);
+    VAO = VBO = EBO = instance_buffer = indirect_buffer = 0;
+
+    vertices.clear();
+    indices.clear();
+    meshes.clear();
+    instance_mesh.clear();
+    instances.clear();
+    instance_slot.clear();
+    commands.clear();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+
+// per-instance data, vertex attributes of lighting.vert with FEATURE_INSTANCED
+struct InstanceData {
+    glm::mat4 model;        // location 3..6
+    glm::mat3 normal;       // location 7..9, normal matrix computed on CPU
+    GLint layer;            // location 10, layer of texture array
+};
+
+// Several meshes in one vertex/index buffer, drawn with a single glMultiDrawElementsIndirect.
+// Every mesh can have any number of instances (transform + texture layer),
+// so objects with different geometry and different textures (layers of one TextureArray) need one draw call.
+class MeshBatch {
+public:
+    unsigned add_mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);     // returns mesh id
+    unsigned add_instance(const unsigned mesh, const GLint layer);                                  // returns instance id
+    void build(void);       // upload geometry, create VAO and indirect commands (after all add_*)
+
+    void set_transform(const unsigned instance, const glm::mat4& model_matrix);
+
+    void draw(void);        // upload changed instances + one multi-draw call, program and texture must be bound by caller
+
+    void clear(void);
+
+private:
+    struct MeshRange {
+        GLuint first_index, index_count;
+        GLint base_vertex;
+    };
+
+    // layout required by glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand {
+        GLuint count, instanceCount, firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<MeshRange> meshes;
+    std::vector<unsigned> instance_mesh;        // instance id -> mesh id
+
+    std::vector<InstanceData> instances;        // sorted by mesh (after build), contiguous per draw command
+    std::vector<size_t> instance_slot;          // instance id -> index into instances
+    std::vector<DrawElementsIndirectCommand> commands;
+    bool instances_dirty = true;
+
+    GLuint VAO{ 0 }, VBO{ 0 }, EBO{ 0 }, instance_buffer{ 0 }, indirect_buffer{ 0 };
+};
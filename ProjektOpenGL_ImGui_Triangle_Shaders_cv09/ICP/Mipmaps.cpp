@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_SSE2 1
+#endif
+
+#include "Mipmaps.hpp"
+
+namespace {
+    // 12-bit linear values: sum of 4 texels fits to 16 bits, precision is enough for 8-bit sRGB output
+    struct Tables {
+        std::array<uint16_t, 256> to_linear;        // sRGB 8 bit -> linear 12 bit
+        std::array<uint16_t, 256> alpha_to_12;      // alpha 8 bit -> 12 bit (no gamma)
+        std::array<uint8_t, 4096> to_srgb;          // linear 12 bit -> sRGB 8 bit
+
+        Tables() {
+            for (int i = 0; i < 256; i++) {
+                double c = i / 255.0;
+                double lin = (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+                to_linear[i] = uint16_t(std::lround(lin * 4095.0));
+                alpha_to_12[i] = uint16_t(std::lround(i * 4095.0 / 255.0));
+            }
+            for (int i = 0; i < 4096; i++) {
+                double lin = i / 4095.0;
+                double c = (lin <= 0.0031308) ? lin * 12.92 : 1.055 * std::pow(lin, 1.0 / 2.4) - 0.055;
+                to_srgb[i] = uint8_t(std::lround(std::clamp(c, 0.0, 1.0) * 255.0));
+            }
+        }
+    };
+    const Tables& tables(void) {
+        static const Tables t;  // thread safe initialization
+        return t;
+    }
+
+    // one row of RGBA8 -> 12-bit linear
+    void decode_row(const uint8_t* src, const int width, uint16_t* dst) {
+        const Tables& t = tables();
+        for (int i = 0; i < width; i++) {
+            dst[i * 4 + 0] = t.to_linear[src[i * 4 + 0]];
+            dst[i * 4 + 1] = t.to_linear[src[i * 4 + 1]];
+            dst[i * 4 + 2] = t.to_linear[src[i * 4 + 2]];
+            dst[i * 4 + 3] = t.alpha_to_12[src[i * 4 + 3]];
+        }
+    }
+}
+
+int mip_levels(const int size)
+{
+    int levels = 1;
+    for (int s = size; s > 1; s /= 2)
+        levels++;
+    return levels;
+}
+
+void mip_downsample(const uint8_t* src, const int width, const int height, uint8_t* dst)
+{
+    const Tables& t = tables();
+    const int dst_w = std::max(1, width / 2), dst_h = std::max(1, height / 2);
+
+    std::vector<uint16_t> row0(size_t(width) * 4), row1(size_t(width) * 4), sum(size_t(dst_w) * 4);
+
+    for (int y = 0; y < dst_h; y++) {
+        decode_row(src + size_t(std::min(2 * y, height - 1)) * width * 4, width, row0.data());
+        decode_row(src + size_t(std::min(2 * y + 1, height - 1)) * width * 4, width, row1.data());
+
+        int x = 0;
+#ifdef MIP_SSE2
+        // 2 output texels per iteration: 4 source texels of both rows, all channels at once
+        if (width % 2 == 0) {
+            for (; x + 2 <= dst_w; x += 2) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row0[x * 8]));       // texels 2x, 2x+1
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row0[x * 8 + 8]));   // texels 2x+2, 2x+3
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row1[x * 8]));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row1[x * 8 + 8]));
+                __m128i s01 = _mm_add_epi16(a, c);
+                __m128i s23 = _mm_add_epi16(b, d);
+                // horizontal pairs: (texel 0 + texel 1) | (texel 2 + texel 3)
+                __m128i s = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+                s = _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&sum[x * 4]), s);
+            }
+        }
+#endif
+        for (; x < dst_w; x++) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; c++)
+                sum[x * 4 + c] = uint16_t((row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c] + 2) >> 2);
+        }
+
+        uint8_t* out = dst + size_t(y) * dst_w * 4;
+        for (int i = 0; i < dst_w; i++) {
+            out[i * 4 + 0] = t.to_srgb[sum[i * 4 + 0]];
+            out[i * 4 + 1] = t.to_srgb[sum[i * 4 + 1]];
+            out[i * 4 + 2] = t.to_srgb[sum[i * 4 + 2]];
+            out[i * 4 + 3] = uint8_t((sum[i * 4 + 3] * 255 + 2047) / 4095);
+        }
+    }
+}
+
+std::vector<uint8_t> mip_chain(const uint8_t* level0, const int size)
+{
+    size_t total = 0;
+    for (int s = size; ; s /= 2) {
+        total += size_t(s) * s * 4;
+        if (s == 1)
+            break;
+    }
+
+    std::vector<uint8_t> chain(total);
+    std::memcpy(chain.data(), level0, size_t(size) * size * 4);
+
+    size_t offset = 0;
+    for (int s = size; s > 1; s /= 2) {
+        size_t next = offset + size_t(s) * s * 4;
+        mip_downsample(chain.data() + offset, s, s, chain.data() + next);
+        offset = next;
+    }
+    return chain;
+}
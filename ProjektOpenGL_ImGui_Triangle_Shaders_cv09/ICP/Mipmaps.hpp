@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU mip chain generation for RGBA8 sRGB-encoded images (texture import on worker threads).
+// 2x2 box filter done in linear light: RGB decoded from sRGB, averaged and encoded back, alpha averaged directly.
+// Averaging sRGB values directly makes distant textures darker than they should be.
+
+int mip_levels(const int size);     // full chain down to 1x1
+
+// next level: dst is max(1, width/2) x max(1, height/2); odd edge texels are clamped
+void mip_downsample(const uint8_t* src, const int width, const int height, uint8_t* dst);
+
+// all levels of square image one after another, level 0 included
+std::vector<uint8_t> mip_chain(const uint8_t* level0, const int size);
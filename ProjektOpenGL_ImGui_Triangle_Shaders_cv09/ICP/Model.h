@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cfloat>
 #include <filesystem>
 #include <string>
 #include <vector> 
@@ -10,6 +11,11 @@
 #include "ShaderProgram.hpp"
 #include "OBJloader.hpp"
 
+// normal matrix for given model matrix, computed once per object instead of per vertex in shader
+inline glm::mat3 normal_matrix(glm::mat4 const& model_matrix) {
+    return glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+}
+
 class Model
 {
 public:
@@ -19,11 +25,12 @@ public:
     glm::vec3 origin{};
     glm::vec3 orientation{};
     glm::vec3 size{};
+    glm::vec4 bounds{ 0.0f };   // bounding sphere in model space: xyz = center, w = radius
 
     Model() = default;
 
     //Model(const std::filesystem::path filename, ShaderProgram& shader) {
-    Model(const char* path, ShaderProgram& shader, const char* texturePath) {
+    Model(const char* path, TextureArray& textures, const char* texturePath) {
         std::vector<GLuint> indices;
         std::vector<Vertex> vertices;
 
@@ -32,7 +39,15 @@ public:
         origin = glm::vec3(0.0f);
         size = glm::vec3(1.0f);
 
-        Mesh mesh = Mesh(GL_TRIANGLES, shader, vertices, indices, origin, orientation, texturePath);
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+        for (auto const& v : vertices) {
+            lo = glm::min(lo, v.Position);
+            hi = glm::max(hi, v.Position);
+        }
+        if (!vertices.empty())
+            bounds = glm::vec4((lo + hi) * 0.5f, glm::length(hi - lo) * 0.5f);
+
+        Mesh mesh = Mesh(GL_TRIANGLES, vertices, indices, origin, orientation, &textures, texturePath);
         meshes.push_back(mesh);
     }
 
@@ -42,10 +57,25 @@ public:
         // origin += glm::vec3(3,0,0) * delta_t; s=s0+v*dt
     }
 
-    void draw(glm::vec3 const& offset = glm::vec3(0.0f), glm::vec3 const& rotation = glm::vec3(0.0f)) {
+    // union of material features of all meshes, selects the shader variant
+    unsigned features() const {
+        unsigned f = 0;
+        for (auto const& mesh : meshes)
+            f |= mesh.features;
+        return f;
+    }
+
+    void draw(ShaderProgram& shader, glm::vec3 const& offset = glm::vec3(0.0f), glm::vec3 const& rotation = glm::vec3(0.0f)) {
         // call draw() on mesh (all meshes)
         for (auto &mesh : meshes) {
-            mesh.draw(origin + offset, orientation + rotation);
+            mesh.draw(shader, origin + offset, orientation + rotation);
+        }
+    }
+
+    // geometry only, no material (depth pre-pass)
+    void draw_geometry(void) {
+        for (auto &mesh : meshes) {
+            mesh.draw_geometry();
         }
     }
 }
@@ -13,17 +13,98 @@ GLuint progID;
 // https://docs.gl/gl4/glUniform
 
 ShaderProgram::ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file)
+	: ShaderProgram(VS_file, FS_file, {})
 {
-	std::vector<GLuint> shader_ids;
+}
 
-	shader_ids.push_back(compile_shader(VS_file, GL_VERTEX_SHADER));
-	shader_ids.push_back(compile_shader(FS_file, GL_FRAGMENT_SHADER));
+ShaderProgram::ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file, const std::vector<std::string>& defines)
+{
+	// only submit the work, the driver may compile in parallel (see finish())
+	pending_shaders.push_back(compile_shader(VS_file, GL_VERTEX_SHADER, defines));
+	pending_sources.push_back(VS_file);
+	pending_shaders.push_back(compile_shader(FS_file, GL_FRAGMENT_SHADER, defines));
+	pending_sources.push_back(FS_file);
 
-	ID = link_shader(shader_ids);
+	ID = link_shader(pending_shaders);
 	progID = ID;
 }
 
+ShaderProgram::ShaderProgram(const std::filesystem::path& CS_file)
+{
+	pending_shaders.push_back(compile_shader(CS_file, GL_COMPUTE_SHADER));
+	pending_sources.push_back(CS_file);
+
+	ID = link_shader(pending_shaders);
+	progID = ID;
+}
+
+void ShaderProgram::init_parallel_compile(void)
+{
+	// 0xFFFFFFFF = let the implementation choose the number of compiler threads
+	if (GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		std::cout << "Parallel shader compile: KHR\n";
+	}
+	else if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		std::cout << "Parallel shader compile: ARB\n";
+	}
+	else
+		std::cout << "Parallel shader compile not supported.\n";
+}
+
+bool ShaderProgram::isReady(void)
+{
+	if (pending_shaders.empty())
+		return true;
+
+	// without the extension any status query blocks, so there is nothing to poll
+	if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile)
+		return true;
+
+	// link was issued right after compile, so link completion implies compile completion
+	GLint done = GL_FALSE;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+void ShaderProgram::finish(void)
+{
+	if (pending_shaders.empty())
+		return;
+
+	// check compile results first, they give better error messages than failed link
+	for (size_t i = 0; i < pending_shaders.size(); i++) {
+		GLint cmpl_status;
+		glGetShaderiv(pending_shaders[i], GL_COMPILE_STATUS, &cmpl_status);
+		if (cmpl_status == GL_FALSE) {
+			std::cerr << pending_sources[i].generic_string() << ":\n" << getShaderInfoLog(pending_shaders[i]);
+			clear();
+			throw std::runtime_error("Shader compile err.\n");
+		}
+	}
+
+	{ // check link result, print info & throw error (if any)
+		GLint status;
+		glGetProgramiv(ID, GL_LINK_STATUS, &status);
+		if (status == GL_FALSE) {
+			std::cerr << getProgramInfoLog(ID);
+			clear();
+			throw std::runtime_error("Link err.\n");
+		}
+	}
+
+	// program is linked, shader objects are no longer needed
+	for (GLuint id : pending_shaders) {
+		glDetachShader(ID, id);
+		glDeleteShader(id);
+	}
+	pending_shaders.clear();
+	pending_sources.clear();
+}
+
 void ShaderProgram::setUniform(const std::string& name, const float val) {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -33,6 +114,7 @@ void ShaderProgram::setUniform(const std::string& name, const float val) {
 }
 
 void ShaderProgram::setUniform(const std::string& name, const int val) {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -41,8 +123,29 @@ void ShaderProgram::setUniform(const std::string& name, const int val) {
 	glUniform1i(loc, val);
 }
 
+void ShaderProgram::setUniform(const std::string& name, const glm::vec2 val) {
+	finish();
+	auto loc = glGetUniformLocation(ID, name.c_str());
+	if (loc == -1) {
+		std::cerr << "no uniform with name:" << name << '\n';
+		return;
+	}
+	glUniform2fv(loc, 1, glm::value_ptr(val));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::uvec3 val) {
+	finish();
+	auto loc = glGetUniformLocation(ID, name.c_str());
+	if (loc == -1) {
+		std::cerr << "no uniform with name:" << name << '\n';
+		return;
+	}
+	glUniform3uiv(loc, 1, glm::value_ptr(val));
+}
+
 void ShaderProgram::setUniform(const std::string& name, const glm::vec3 val)
 {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -53,6 +156,7 @@ void ShaderProgram::setUniform(const std::string& name, const glm::vec3 val)
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::vec4 in_vec4) {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -64,6 +168,7 @@ void ShaderProgram::setUniform(const std::string& name, const glm::vec4 in_vec4)
 
 void ShaderProgram::setUniform(const std::string& name, const glm::mat3 val)
 {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -74,6 +179,7 @@ void ShaderProgram::setUniform(const std::string& name, const glm::mat3 val)
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::mat4 val) {
+	finish();
 	auto loc = glGetUniformLocation(ID, name.c_str());
 	if (loc == -1) {
 		std::cerr << "no uniform with name:" << name << '\n';
@@ -111,26 +217,19 @@ std::string ShaderProgram::getProgramInfoLog(const GLuint obj)
 	return s;
 }
 
-GLuint ShaderProgram::compile_shader(const std::filesystem::path& source_file, const GLenum type)
+GLuint ShaderProgram::compile_shader(const std::filesystem::path& source_file, const GLenum type, const std::vector<std::string>& defines)
 {
 	GLuint shader_h;
 
 	shader_h = glCreateShader(type);
 
-	std::string src = textFileRead(source_file);
+	std::string src = inject_defines(textFileRead(source_file), defines);
 	const char* shader_string = src.c_str();
 
 	glShaderSource(shader_h, 1, &shader_string, NULL);
 
+	// no status query here - it would stall until the compile is done, see finish()
 	glCompileShader(shader_h);
-	{ // check compile result, display error (if any)
-		GLint cmpl_status;
-		glGetShaderiv(shader_h, GL_COMPILE_STATUS, &cmpl_status);
-		if (cmpl_status == GL_FALSE) {
-			std::cerr << getShaderInfoLog(shader_h);
-			throw std::runtime_error("Shader compile err.\n");
-		}
-	}
 
 	return shader_h;
 }
@@ -142,15 +241,9 @@ GLuint ShaderProgram::link_shader(const std::vector<GLuint> shader_ids)
 	for (int id : shader_ids)
 		glAttachShader(prog_h, id);
 
+	// link is queued behind the compiles, result is checked in finish()
 	glLinkProgram(prog_h);
-	{ // TODO: implement: check link result, print info & throw error (if any)
-		GLint status;
-		glGetProgramiv(prog_h, GL_LINK_STATUS, &status);
-		if (status == GL_FALSE) {
-			std::cerr << getProgramInfoLog(prog_h);
-			throw std::runtime_error("Link err.\n");
-		}
-	}
+
 	return prog_h;
 }
 
@@ -164,7 +257,29 @@ std::string ShaderProgram::textFileRead(const std::filesystem::path& filename)
 	return ss.str();
 }
 
+std::string ShaderProgram::inject_defines(const std::string& src, const std::vector<std::string>& defines)
+{
+	if (defines.empty())
+		return src;
+
+	// #version must stay the first line, defines go right after it
+	size_t pos = 0;
+	if (src.compare(0, 8, "#version") == 0) {
+		pos = src.find('\n');
+		pos = (pos == std::string::npos) ? src.size() : pos + 1;
+	}
+
+	std::string header;
+	for (auto const& d : defines)
+		header += "#define " + d + "\n";
+	// keep line numbers in compiler errors matching the file
+	header += "#line " + std::to_string(pos ? 2 : 1) + "\n";
+
+	return src.substr(0, pos) + header + src.substr(pos);
+}
+
 GLuint ShaderProgram::getID()
 {
+	finish();
 	return ID;
 }
\ No newline at end of file
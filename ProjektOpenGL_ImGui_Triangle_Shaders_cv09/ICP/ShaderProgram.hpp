@@ -1,30 +1,47 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <filesystem>
 
 #include <GL/glew.h> 
 
+#include "GLState.hpp"
+
 class ShaderProgram {
 public:
 	// you can add more constructors for pipeline with GS, TS etc.
 	ShaderProgram(void) = default; //does nothing
-	ShaderProgram(const std::filesystem::path & VS_file, const std::filesystem::path & FS_file); // TODO: load, compile, and link shader
+	ShaderProgram(const std::filesystem::path & VS_file, const std::filesystem::path & FS_file); // submit compile + link, does NOT wait for the driver
+	ShaderProgram(const std::filesystem::path & VS_file, const std::filesystem::path & FS_file, const std::vector<std::string> & defines); // same, each define is injected as "#define X" after #version
+	explicit ShaderProgram(const std::filesystem::path & CS_file); // compute shader only (run by glDispatchCompute after activate())
 
-	void activate(void) { glUseProgram(ID); };    // activate shader
-	void deactivate(void) { glUseProgram(0); };   // deactivate current shader program (i.e. activate shader no. 0)
+	void activate(void) { finish(); gl_state.useProgram(ID); };    // activate shader (first use checks compile/link result)
+	void deactivate(void) { gl_state.useProgram(0); };   // deactivate current shader program (i.e. activate shader no. 0)
 
 	void clear(void) { 	//deallocate shader program
 		deactivate();
+		for (GLuint id : pending_shaders)
+			glDeleteShader(id);
+		pending_shaders.clear();
 		glDeleteProgram(ID);
 		ID = 0;
 	}
     
+    // Asynchronous build (GL_KHR_parallel_shader_compile)
+    // Constructor only submits the work, so many programs can be compiled by the driver concurrently.
+    // Status is checked lazily - when the program is used for the first time (or by explicit finish()).
+    static void init_parallel_compile(void);  // call once after glewInit(), enables driver compiler threads
+    bool isReady(void);                       // non-blocking: true if finish() will not stall
+    void finish(void);                        // wait for compile + link, throw on error
+
     // set uniform according to name 
     // https://docs.gl/gl4/glUniform
     void setUniform(const std::string & name, const float val);      
     void setUniform(const std::string & name, const int val);        // TODO: implement 
+    void setUniform(const std::string & name, const glm::vec2 val);
     void setUniform(const std::string & name, const glm::vec3 val);  
+    void setUniform(const std::string & name, const glm::uvec3 val);
     void setUniform(const std::string & name, const glm::vec4 val);  // TODO: implement
     void setUniform(const std::string & name, const glm::mat3 val);   
     void setUniform(const std::string & name, const glm::mat4 val);  // TODO: implement
@@ -33,11 +50,15 @@ public:
     
 private:
 	GLuint ID{0}; // default = 0, empty shader
+	std::vector<GLuint> pending_shaders;                  // submitted, status not checked yet
+	std::vector<std::filesystem::path> pending_sources;   // for error messages
+
 	std::string getShaderInfoLog(const GLuint obj);   // TODO: check for shader compilation error; if any, print compiler output  
 	std::string getProgramInfoLog(const GLuint obj);  // TODO: check for linker error; if any, print linker output
 
-	GLuint compile_shader(const std::filesystem::path & source_file, const GLenum type); // TODO: try to load and compile shader
+	GLuint compile_shader(const std::filesystem::path & source_file, const GLenum type, const std::vector<std::string> & defines = {}); // TODO: try to load and compile shader
 	GLuint link_shader(const std::vector<GLuint> shader_ids);                            // TODO: try to link all shader IDs to final program
     std::string textFileRead(const std::filesystem::path & filename);                    // TODO: load text file
+    std::string inject_defines(const std::string & src, const std::vector<std::string> & defines);
 };
 
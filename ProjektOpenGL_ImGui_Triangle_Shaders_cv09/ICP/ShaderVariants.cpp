@@ -0,0 +1,53 @@
+#include <iostream>
+
+#include "ShaderVariants.hpp"
+
+ShaderVariants::ShaderVariants(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file, const std::vector<std::string>& feature_names, const unsigned used_features)
+    : VS_file(VS_file), FS_file(FS_file), feature_names(feature_names)
+{
+    const unsigned count = 1u << feature_names.size();
+    used = used_features & (count - 1);
+
+    variants.resize(count);
+    is_built.assign(count, false);
+    last_frame.assign(count, ~0ull);
+}
+
+ShaderProgram& ShaderVariants::get(const unsigned features)
+{
+    const unsigned mask = features & used;
+    if (mask >= variants.size())
+        throw std::runtime_error("Unknown shader variant: " + std::to_string(features));
+
+    if (!is_built[mask]) {
+        std::vector<std::string> defines;
+        for (size_t bit = 0; bit < feature_names.size(); bit++)
+            if (mask & (1u << bit))
+                defines.push_back(feature_names[bit]);
+
+        variants[mask] = ShaderProgram(VS_file, FS_file, defines);
+        is_built[mask] = true;
+        built_count++;
+        std::cout << "Shader variant " << mask << " built (" << VS_file.generic_string() << ", " << FS_file.generic_string() << ")\n";
+    }
+    return variants[mask];
+}
+
+bool ShaderVariants::first_use(const unsigned features, const unsigned long long frame)
+{
+    if (last_frame.at(features & used) == frame)
+        return false;
+    last_frame[features & used] = frame;
+    return true;
+}
+
+void ShaderVariants::clear(void)
+{
+    for (size_t i = 0; i < variants.size(); i++)
+        if (is_built[i])
+            variants[i].clear();
+    variants.clear();
+    is_built.clear();
+    built_count = 0;
+    last_frame.clear();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.hpp"
+
+// feature bits of lighting.vert/lighting.frag permutations,
+// bit i is compiled in as "#define <name i>" (see lighting_feature_names)
+enum LightingFeature : unsigned {
+    FEATURE_DIRLIGHT  = 1u << 0,   // directional light (diffuse)
+    FEATURE_SPECULAR  = 1u << 1,   // specular of directional light
+    FEATURE_SPOTLIGHT = 1u << 2,   // spotlight
+    FEATURE_TEXTURE   = 1u << 3,   // material has diffuse texture (else uniform materialColor)
+    FEATURE_ALPHA     = 1u << 4,   // output texture alpha (transparent pass)
+    FEATURE_INSTANCED = 1u << 5,   // transform, normal matrix and texture layer from instance attributes (MeshBatch)
+    FEATURE_CLUSTERED = 1u << 6,   // point/spot lights from SSBO, only lights of fragment's cluster (LightClusters)
+    FEATURE_DEFERRED  = 1u << 7,   // lighting pass of deferred path, surface from G-buffer (GBuffer)
+};
+
+inline const std::vector<std::string> lighting_feature_names = {
+    "FEATURE_DIRLIGHT", "FEATURE_SPECULAR", "FEATURE_SPOTLIGHT", "FEATURE_TEXTURE", "FEATURE_ALPHA", "FEATURE_INSTANCED",
+    "FEATURE_CLUSTERED", "FEATURE_DEFERRED"
+};
+
+// All permutations of one VS+FS pair, selected by feature bitmask.
+// A variant is built on its first get(), so only masks the renderer actually selects are compiled
+// (first frame that needs a new combination pays for its compile + link).
+// used_features limits the permutations to features the shader pair actually has,
+// other bits of the mask passed to get() are ignored.
+class ShaderVariants {
+public:
+    ShaderVariants(void) = default;
+    ShaderVariants(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file, const std::vector<std::string>& feature_names, const unsigned used_features = ~0u);
+
+    ShaderProgram& get(const unsigned features);    // program for given feature mask, built on first request
+    size_t size(void) const { return variants.size(); }
+    unsigned built(void) const { return built_count; }
+
+    // true only for the first call with given frame number -> upload per-frame uniforms into the variant
+    bool first_use(const unsigned features, const unsigned long long frame);
+
+    void clear(void);
+
+private:
+    std::filesystem::path VS_file, FS_file;
+    std::vector<std::string> feature_names;
+    std::vector<ShaderProgram> variants;            // index = feature mask, not built yet = empty (ID 0)
+    std::vector<bool> is_built;
+    unsigned built_count = 0;
+    unsigned used = ~0u;
+    std::vector<unsigned long long> last_frame;     // frame number of last per-frame uniform upload
+};
@@ -0,0 +1,146 @@
+#include <cfloat>
+#include <stdexcept>
+
+#include "GLState.hpp"
+#include "ShadowMap.hpp"
+
+void ShadowMap::create(void)
+{
+    for (GLuint* map : { &static_map, &final_map }) {
+        glCreateTextures(GL_TEXTURE_2D, 1, map);
+        glTextureStorage2D(*map, 1, GL_DEPTH_COMPONENT32F, size, size);
+
+        // hardware depth comparison + 2x2 PCF, outside of the map = lit
+        glTextureParameteri(*map, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTextureParameteri(*map, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glTextureParameteri(*map, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(*map, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(*map, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTextureParameteri(*map, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        const GLfloat border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTextureParameterfv(*map, GL_TEXTURE_BORDER_COLOR, border);
+    }
+
+    glCreateFramebuffers(1, &static_FBO);
+    glNamedFramebufferTexture(static_FBO, GL_DEPTH_ATTACHMENT, static_map, 0);
+    glCreateFramebuffers(1, &final_FBO);
+    glNamedFramebufferTexture(final_FBO, GL_DEPTH_ATTACHMENT, final_map, 0);
+    for (GLuint fbo : { static_FBO, final_FBO }) {
+        glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+        glNamedFramebufferReadBuffer(fbo, GL_NONE);
+        if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("Shadow map framebuffer incomplete.");
+    }
+}
+
+bool ShadowMap::in_volume(const Model& model, const glm::mat4& model_matrix) const
+{
+    // corners of bounding sphere's box -> light clip space, overlap with clip volume
+    const glm::mat4 M = projection * view * model_matrix;
+    const glm::vec3 c(model.bounds), r(model.bounds.w);
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 p = M * glm::vec4(c + r * glm::vec3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1), 1.0f);
+        if (p.w <= 0.0f)
+            return true;    // crosses light plane, be conservative
+        lo = glm::min(lo, glm::vec3(p) / p.w);
+        hi = glm::max(hi, glm::vec3(p) / p.w);
+    }
+    return glm::all(glm::lessThanEqual(lo, glm::vec3(1.0f))) && glm::all(glm::greaterThanEqual(hi, glm::vec3(-1.0f)));
+}
+
+size_t ShadowMap::render(const GLuint target, const bool dynamic, const std::vector<ShadowCaster>& casters, ShaderProgram& depth_program)
+{
+    gl_state.bindFramebuffer(target);
+
+    depth_program.activate();
+    depth_program.setUniform("uV_m", view);
+    depth_program.setUniform("uP_m", projection);
+
+    size_t drawn = 0;
+    for (auto const& caster : casters) {
+        if (caster.dynamic != dynamic || !in_volume(*caster.model, caster.model_matrix))
+            continue;
+        depth_program.setUniform("uM_m", caster.model_matrix);
+        caster.model->draw_geometry();
+        drawn++;
+    }
+    renders++;
+    return drawn;
+}
+
+bool ShadowMap::update(const glm::mat4& light_view, const glm::mat4& light_projection, const std::vector<ShadowCaster>& casters, ShaderProgram& depth_program)
+{
+    if (static_map == 0)
+        create();
+
+    std::vector<glm::mat4> static_now, dynamic_now;
+    for (auto const& caster : casters)
+        (caster.dynamic ? dynamic_now : static_now).push_back(caster.model_matrix);
+
+    // light moved -> everything; static caster moved -> static layer (and so final map)
+    bool static_dirty = light_view != view || light_projection != projection || static_now != static_matrices;
+    view = light_view;
+    projection = light_projection;
+
+    // dynamic caster moved inside volume (before or after the move) -> final map
+    bool dynamic_dirty = static_dirty || dynamic_now.size() != dynamic_matrices.size();
+    if (!dynamic_dirty) {
+        size_t i = 0;
+        for (auto const& caster : casters) {
+            if (!caster.dynamic)
+                continue;
+            if (caster.model_matrix != dynamic_matrices[i] &&
+                (in_volume(*caster.model, caster.model_matrix) || in_volume(*caster.model, dynamic_matrices[i]))) {
+                dynamic_dirty = true;
+                break;
+            }
+            i++;
+        }
+    }
+
+    if (!static_dirty && !dynamic_dirty)
+        return false;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, size, size);
+    gl_state.depthMask(true);
+    gl_state.enable(GL_POLYGON_OFFSET_FILL, true);
+    gl_state.polygonOffset(2.0f, 4.0f);     // slope scaled bias against shadow acne
+
+    const GLfloat far_depth = 1.0f;
+    if (static_dirty) {
+        glClearNamedFramebufferfv(static_FBO, GL_DEPTH, 0, &far_depth);
+        static_drawn = render(static_FBO, false, casters, depth_program);
+        static_matrices = static_now;
+    }
+
+    // final = static layer + dynamic casters (empty static layer, e.g. everything animated: clear is enough)
+    if (static_drawn > 0)
+        glCopyImageSubData(static_map, GL_TEXTURE_2D, 0, 0, 0, 0, final_map, GL_TEXTURE_2D, 0, 0, 0, 0, size, size, 1);
+    else
+        glClearNamedFramebufferfv(final_FBO, GL_DEPTH, 0, &far_depth);
+    render(final_FBO, true, casters, depth_program);
+    dynamic_matrices = dynamic_now;
+
+    gl_state.enable(GL_POLYGON_OFFSET_FILL, false);
+    gl_state.bindFramebuffer(0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    return true;
+}
+
+void ShadowMap::clear(void)
+{
+    gl_state.bindFramebuffer(0);
+    GLuint fbos[] = { static_FBO, final_FBO };
+    glDeleteFramebuffers(2, fbos);
+    GLuint maps[] = { static_map, final_map };
+    glDeleteTextures(2, maps);
+    static_FBO = final_FBO = static_map = final_map = 0;
+
+    view = projection = glm::mat4(0.0f);
+    static_matrices.clear();
+    dynamic_matrices.clear();
+    static_drawn = 0;
+}
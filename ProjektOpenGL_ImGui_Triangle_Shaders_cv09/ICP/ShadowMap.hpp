@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+#include "ShaderProgram.hpp"
+
+// one shadow casting object for this frame
+struct ShadowCaster {
+    Model* model;
+    glm::mat4 model_matrix;
+    bool dynamic;           // expected to move; static casters are rendered into a separate cached layer
+};
+
+// Cached shadow map of one spot (perspective) or directional (orthographic) light.
+// Nothing is rendered while the light and all casters in its volume stay still:
+//   static layer   - static casters, re-rendered only when the light or a static caster moves
+//   final map      - copy of static layer + dynamic casters, re-rendered only when
+//                    the static layer changed or a dynamic caster moved inside the light volume
+//                    (static layer without any caster in the volume is not copied, final map is just cleared)
+// Final map is sampled by lighting.frag (sampler2DShadow).
+class ShadowMap {
+public:
+    ShadowMap(void) = default;
+    explicit ShadowMap(const int size) : size(size) {}
+
+    // depth_program = depth-only, non-instanced (uV_m, uP_m, uM_m)
+    // returns true if anything was re-rendered
+    bool update(const glm::mat4& light_view, const glm::mat4& light_projection, const std::vector<ShadowCaster>& casters, ShaderProgram& depth_program);
+
+    GLuint getID(void) const { return final_map; }
+    glm::mat4 light_space(void) const { return projection * view; }
+
+    unsigned long renders = 0;      // statistics: number of (layer) re-renders since start
+
+    void clear(void);
+
+private:
+    void create(void);
+    // returns number of casters drawn (the others are outside of the light volume)
+    size_t render(const GLuint target, const bool dynamic, const std::vector<ShadowCaster>& casters, ShaderProgram& depth_program);
+    bool in_volume(const Model& model, const glm::mat4& model_matrix) const;
+
+    int size = 1024;
+    GLuint static_map{ 0 }, final_map{ 0 };
+    GLuint static_FBO{ 0 }, final_FBO{ 0 };
+
+    glm::mat4 view{ 0.0f }, projection{ 0.0f };
+    std::vector<glm::mat4> static_matrices;         // static caster transforms of last static render
+    std::vector<glm::mat4> dynamic_matrices;        // dynamic caster transforms of last dynamic render
+    size_t static_drawn = 0;                        // casters in static layer
+};
@@ -0,0 +1,398 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#include <opencv2/opencv.hpp>
+
+#include "../include/stb_image.h"
+
+#include "GLState.hpp"
+#include "Mipmaps.hpp"
+#include "TextureArray.hpp"
+
+TextureArray::~TextureArray()
+{
+    wait_jobs();
+}
+
+void TextureArray::wait_jobs(void)
+{
+    for (auto& job : jobs)
+        job.wait();
+    jobs.clear();
+}
+
+int TextureArray::add(const std::string& path, int& channels)
+{
+    if (ID != 0)
+        throw std::runtime_error("TextureArray: layers can not be added after upload.");
+
+    // header only, decoding is done later (channels select FEATURE_ALPHA right now)
+    int width, height;
+    if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+        std::cerr << "Failed to load texture: " << path << std::endl;
+        return -1;
+    }
+
+    const int layer = layer_count++;
+    if (pool)
+        jobs.push_back(pool->submit([this, path, layer]() { decode(path, layer); }));
+    else
+        decode(path, layer);
+    return layer;
+}
+
+int TextureArray::levels(void) const
+{
+    return mip_levels(layer_size);
+}
+
+size_t TextureArray::layer_bytes(void) const
+{
+    size_t total = 0;
+    for (int level = 0, s = layer_size; level < levels(); level++, s = std::max(1, s / 2))
+        total += level_size(format, s, s);
+    return total;
+}
+
+size_t TextureArray::level_offset(const int level) const
+{
+    size_t offset = 0;
+    for (int l = 0, s = layer_size; l < level; l++, s = std::max(1, s / 2))
+        offset += level_size(format, s, s);
+    return offset;
+}
+
+size_t TextureArray::level_bytes(const int level) const
+{
+    const int s = std::max(1, layer_size >> level);
+    return level_size(format, s, s);
+}
+
+size_t TextureArray::resident_bytes(void) const
+{
+    size_t total = 0;
+    for (int level : resident)     // finest resident level of each layer
+        total += layer_bytes() - level_offset(level);
+    return total;
+}
+
+size_t TextureArray::bytes(void) const
+{
+    size_t chain = 0;
+    for (int level = 0, s = layer_size; level < levels(); level++, s = std::max(1, s / 2))
+        chain += level_size(format, s, s);
+    return chain * layer_count;
+}
+
+bool TextureArray::load_rgba(const std::string& path, std::vector<unsigned char>& pixels)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load_thread(true);  // global flag is not thread safe
+    // always ask for 4 channels, all layers must share one format
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data) {
+        std::cerr << "Failed to load texture: " << path << std::endl;
+        return false;
+    }
+
+    pixels.resize(size_t(layer_size) * layer_size * 4);
+    cv::Mat src(height, width, CV_8UC4, data);
+    cv::Mat dst(layer_size, layer_size, CV_8UC4, pixels.data());
+    if (width == layer_size && height == layer_size)
+        src.copyTo(dst);
+    else
+        cv::resize(src, dst, cv::Size(layer_size, layer_size), 0, 0, (width > layer_size) ? cv::INTER_AREA : cv::INTER_LINEAR);
+    stbi_image_free(data);
+
+    if (width != layer_size || height != layer_size)
+        std::cout << "Texture " << path << " resized " << width << 'x' << height << " -> " << layer_size << 'x' << layer_size << '\n';
+    return true;
+}
+
+void TextureArray::decode(const std::string& path, const int layer)
+{
+    DecodedLayer decoded{ layer, {} };
+
+    if (!is_compressed(format)) {
+        std::vector<unsigned char> rgba;
+        if (!load_rgba(path, rgba)) {
+            failed++;
+            return;
+        }
+        // whole chain here, render thread only copies it (no glGenerateMipmap)
+        decoded.pixels = mip_chain(rgba.data(), layer_size);
+    }
+    else {
+        // import cache next to the source, valid while it is newer than the source
+        std::filesystem::path cache = path + (format == TextureFormat::BC1 ? ".bc1.dds" : ".bc3.dds");
+        std::error_code ec;
+        bool fresh = std::filesystem::exists(cache, ec) &&
+            std::filesystem::last_write_time(cache, ec) >= std::filesystem::last_write_time(path, ec) && !ec;
+
+        if (!fresh || !dds_read(cache, format, layer_size, levels(), decoded.pixels)) {
+            std::vector<unsigned char> rgba;
+            if (!load_rgba(path, rgba)) {
+                failed++;
+                return;
+            }
+
+            // mip chain on CPU (compressed texture can not use glGenerateMipmap), each level encoded
+            std::vector<uint8_t> chain = mip_chain(rgba.data(), layer_size);
+            decoded.pixels.resize(layer_bytes());
+            size_t offset = 0, chain_offset = 0;
+            for (int l = 0, s = layer_size; l < levels(); l++, s = std::max(1, s / 2)) {
+                bc_encode(format, chain.data() + chain_offset, s, s, decoded.pixels.data() + offset, pool);
+                offset += level_size(format, s, s);
+                chain_offset += size_t(s) * s * 4;
+            }
+
+            if (dds_write(cache, format, layer_size, levels(), decoded.pixels))
+                std::cout << "Texture " << path << " imported -> " << cache.generic_string() << '\n';
+            else
+                std::cerr << "Texture cache not written: " << cache.generic_string() << '\n';
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mux);
+    ready.push_back(std::move(decoded));
+}
+
+void TextureArray::upload(void)
+{
+    if (ID != 0 || layer_count == 0)
+        return;
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &ID);
+    glTextureParameteri(ID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(ID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // sparse storage if the layer is made of whole pages
+    sparse = false;
+    if (GLEW_ARB_sparse_texture) {
+        GLint page_x = 0, page_y = 0;
+        glGetInternalformativ(GL_TEXTURE_2D_ARRAY, gl_internal_format(format), GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &page_x);
+        glGetInternalformativ(GL_TEXTURE_2D_ARRAY, gl_internal_format(format), GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &page_y);
+        sparse = page_x > 0 && page_y > 0 && layer_size % page_x == 0 && layer_size % page_y == 0;
+    }
+    if (sparse)
+        glTextureParameteri(ID, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+    glTextureStorage3D(ID, levels(), gl_internal_format(format), layer_size, layer_size, layer_count);
+
+    tail = 0;
+    if (sparse) {
+        glGetTextureParameteriv(ID, GL_NUM_SPARSE_LEVELS_ARB, &tail);
+        // only mip tail of each layer is in memory until the residency manager streams finer levels
+        if (tail < levels())
+            for (int layer = 0; layer < layer_count; layer++)
+                commit(layer, tail, true);
+        backing.assign(layer_count, {});
+    }
+    resident.assign(layer_count, tail);
+
+    // per-layer min LOD for shaders
+    std::vector<GLfloat> min_lod(layer_count, (GLfloat)tail);
+    glCreateBuffers(1, &lod_buffer);
+    glNamedBufferStorage(lod_buffer, min_lod.size() * sizeof(GLfloat), min_lod.data(), GL_DYNAMIC_STORAGE_BIT);
+
+    // placeholder until the layer arrives (resident levels only)
+    if (!is_compressed(format)) {
+        const GLubyte grey[] = { 128, 128, 128, 255 };
+        for (GLsizei level = tail; level < levels(); level++)
+            glClearTexImage(ID, level, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    }
+    else {
+        // compressed textures can not be cleared -> upload grey blocks (alpha block: a0 = a1 = 255, color: c0 = c1 = grey)
+        const GLubyte alpha_block[8] = { 255, 255, 0, 0, 0, 0, 0, 0 };
+        const GLubyte color_block[8] = { 0x10, 0x84, 0x10, 0x84, 0, 0, 0, 0 };
+        std::vector<GLubyte> grey(level_size(format, layer_size, layer_size) * layer_count);
+        for (size_t i = 0; i < grey.size(); i += (format == TextureFormat::BC3) ? 16 : 8) {
+            if (format == TextureFormat::BC3) {
+                std::memcpy(&grey[i], alpha_block, 8);
+                std::memcpy(&grey[i + 8], color_block, 8);
+            }
+            else
+                std::memcpy(&grey[i], color_block, 8);
+        }
+        for (int l = tail, s = std::max(1, layer_size >> tail); l < levels(); l++, s = std::max(1, s / 2))
+            glCompressedTextureSubImage3D(ID, l, 0, 0, 0, s, s, layer_count, gl_internal_format(format),
+                (GLsizei)(level_size(format, s, s) * layer_count), grey.data());
+    }
+
+    const GLsizeiptr slot_size = (GLsizeiptr)layer_bytes();
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &PBO);
+    glNamedBufferStorage(PBO, slot_size * PBO_SLOTS, nullptr, flags);
+    pbo_data = static_cast<unsigned char*>(glMapNamedBufferRange(PBO, 0, slot_size * PBO_SLOTS, flags));
+}
+
+int TextureArray::process_uploads(const double budget_ms)
+{
+    if (ID == 0 || PBO == 0)
+        return 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t slot_size = layer_bytes();
+    int count = 0;
+
+    while (true) {
+        // budget is checked after first upload, so loading always progresses
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (count > 0 && elapsed >= budget_ms)
+            break;
+
+        // slot still read by GPU -> next frame
+        GLsync& fence = pbo_fence[pbo_next];
+        if (fence) {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                break;
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        DecodedLayer decoded;
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            if (ready.empty())
+                break;
+            decoded = std::move(ready.front());
+            ready.pop_front();
+        }
+
+        const size_t offset = slot_size * pbo_next;
+        std::memcpy(pbo_data + offset, decoded.pixels.data(), slot_size);
+
+        // precomputed mip chain, resident levels only (sparse: mip tail, finer levels are streamed later)
+        gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+        for (int l = resident[decoded.layer]; l < levels(); l++)
+            upload_level(decoded.layer, l, reinterpret_cast<const void*>(offset + level_offset(l)));
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pbo_next = (pbo_next + 1) % PBO_SLOTS;
+
+        if (sparse)
+            backing[decoded.layer] = std::move(decoded.pixels);
+
+        uploaded++;
+        count++;
+    }
+
+    if (count > 0) {
+        // other pixel transfers (camera texture) must not read from PBO
+        gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // everything uploaded -> staging buffer is not needed any more
+    if (layers_pending() == 0) {
+        wait_jobs();
+        for (GLsync& fence : pbo_fence) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+        glUnmapNamedBuffer(PBO);
+        glDeleteBuffers(1, &PBO);
+        PBO = 0;
+        pbo_data = nullptr;
+        std::cout << "TextureArray: all " << layer_count << " layers uploaded\n";
+    }
+    return count;
+}
+
+void TextureArray::clear(void)
+{
+    wait_jobs();
+    for (GLsync& fence : pbo_fence) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (PBO != 0) {
+        gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glUnmapNamedBuffer(PBO);
+        glDeleteBuffers(1, &PBO);
+    }
+    PBO = 0;
+    pbo_data = nullptr;
+    pbo_next = 0;
+
+    gl_state.bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+    glDeleteTextures(1, &ID);
+    glDeleteBuffers(1, &lod_buffer);
+    ID = 0;
+    lod_buffer = 0;
+    sparse = false;
+    tail = 0;
+    resident.clear();
+    backing.clear();
+    layer_count = 0;
+    uploaded = 0;
+    failed = 0;
+    ready.clear();
+}
+
+void TextureArray::bind(void)
+{
+    // sampler texture_diffuse has layout(binding = 0), layer_min_lod layout(binding = 9)
+    gl_state.bindTexture(0, GL_TEXTURE_2D_ARRAY, ID);
+    gl_state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, lod_buffer);
+}
+
+void TextureArray::upload_level(const int layer, const int level, const void* data)
+{
+    const int s = std::max(1, layer_size >> level);
+    if (!is_compressed(format))
+        glTextureSubImage3D(ID, level, 0, 0, layer, s, s, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    else
+        glCompressedTextureSubImage3D(ID, level, 0, 0, layer, s, s, 1, gl_internal_format(format), (GLsizei)level_size(format, s, s), data);
+}
+
+void TextureArray::commit(const int layer, const int level, const bool on)
+{
+    // whole level of one layer (for level == tail the whole mip tail of the layer)
+    const int s = std::max(1, layer_size >> level);
+    gl_state.bindTexture(0, GL_TEXTURE_2D_ARRAY, ID);
+    glTexPageCommitmentARB(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, s, s, 1, on ? GL_TRUE : GL_FALSE);
+}
+
+void TextureArray::update_min_lod(const int layer)
+{
+    GLfloat lod = (GLfloat)resident[layer];
+    glNamedBufferSubData(lod_buffer, layer * sizeof(GLfloat), sizeof(GLfloat), &lod);
+}
+
+bool TextureArray::can_stream_in(const int layer) const
+{
+    return sparse && !backing.at(layer).empty() && resident[layer] > 0;
+}
+
+bool TextureArray::stream_in(const int layer)
+{
+    if (!can_stream_in(layer))
+        return false;
+
+    const int level = resident[layer] - 1;
+    commit(layer, level, true);
+    gl_state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);    // from client memory
+    upload_level(layer, level, backing[layer].data() + level_offset(level));
+
+    resident[layer] = level;
+    update_min_lod(layer);
+    return true;
+}
+
+bool TextureArray::evict(const int layer)
+{
+    if (!sparse || resident.at(layer) >= tail)
+        return false;   // only mip tail left
+
+    // shaders stop sampling the level first, then the memory is released
+    const int level = resident[layer];
+    resident[layer] = level + 1;
+    update_min_lod(layer);
+    commit(layer, level, false);
+    return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ThreadPool.hpp"
+#include "TextureCompression.hpp"
+
+// Textures of one size and format packed as layers of a single GL_TEXTURE_2D_ARRAY.
+// Objects with different textures can then share one texture binding, so they can be drawn
+// by a single instanced / multi-draw call (layer index is passed per draw or per instance).
+// Every imported image is converted to RGBA8 and resized to layer_size x layer_size.
+//
+// Full mip chain is always built on CPU (Mipmaps.hpp, gamma correct), GL never generates mipmaps.
+// Block compressed arrays (BC1, BC3) are imported once: mip chain is encoded on CPU
+// and cached as <source>.bc1.dds / <source>.bc3.dds next to the source image.
+// Later runs only read the cache (re-encoded when the source is newer or layer size differs).
+//
+// Loading is asynchronous: add() reads only the image header, decoding + resizing runs on the worker pool.
+// Decoded layers are streamed to GL by process_uploads() (render thread, once per frame, time budget)
+// through a persistently mapped pixel unpack buffer. Layers not uploaded yet are grey.
+//
+// With ARB_sparse_texture every mip level of every layer is committed separately (see TextureResidency):
+// levels from tail_level() down (mip tail) are always resident, finer levels are streamed in/out
+// from a CPU copy of the chain. Shaders clamp sampling to the resident level (per-layer min LOD, SSBO binding 9).
+// Without sparse textures all levels are resident.
+class TextureArray {
+public:
+    TextureArray(void) = default;
+    explicit TextureArray(const int layer_size, ThreadPool* pool = nullptr, const TextureFormat format = TextureFormat::RGBA8)
+        : layer_size(layer_size), format(format), pool(pool) {}
+    ~TextureArray();    // waits for decoding jobs (GL objects are released by clear())
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // reserve layer and queue decoding, returns layer index (or -1 on error); channels = channels of the source image
+    int add(const std::string& path, int& channels);
+
+    // create GL texture for all added layers, content arrives later by process_uploads()
+    void upload(void);
+
+    // render thread, every frame: upload decoded layers until budget_ms is spent (at least one layer)
+    // returns number of layers uploaded in this call
+    int process_uploads(const double budget_ms);
+    int layers_pending(void) const { return layer_count - uploaded - failed; }
+
+    void bind(void);                        // texture -> unit 0, per-layer min LOD -> SSBO binding 9
+
+    GLuint getID(void) const { return ID; }
+    int size(void) const { return layer_size; }
+    int levels(void) const;                 // full mip chain
+    size_t bytes(void) const;               // GPU memory of all layers incl. mipmaps, if all resident
+    int layers(void) const { return layer_count; }
+
+    // residency
+    bool is_sparse(void) const { return sparse; }
+    int tail_level(void) const { return tail; }                                 // coarsest streamed level + 1
+    int resident_level(const int layer) const { return resident.at(layer); }    // finest level in GPU memory
+    bool can_stream_in(const int layer) const;  // sparse, decoded and not complete
+    bool stream_in(const int layer);        // commit + upload next finer level, false if not possible
+    bool evict(const int layer);            // decommit finest level (mip tail stays), false if not possible
+    size_t level_bytes(const int level) const;  // one level of one layer
+    size_t resident_bytes(void) const;
+
+    void clear(void);
+
+private:
+    struct DecodedLayer {
+        int layer;
+        std::vector<unsigned char> pixels;  // all levels, one after another
+    };
+    void decode(const std::string& path, const int layer);     // worker thread
+    bool load_rgba(const std::string& path, std::vector<unsigned char>& pixels);   // decode + resize to layer_size
+    size_t layer_bytes(void) const;         // size of DecodedLayer::pixels
+    size_t level_offset(const int level) const;     // offset of level in DecodedLayer::pixels
+    void upload_level(const int layer, const int level, const void* data);     // from bound unpack buffer or client memory
+    void commit(const int layer, const int level, const bool on);
+    void update_min_lod(const int layer);
+    void wait_jobs(void);
+
+    int layer_size = 0;
+    TextureFormat format = TextureFormat::RGBA8;
+    int layer_count = 0;
+    GLuint ID = 0;
+
+    ThreadPool* pool = nullptr;                 // nullptr = decode synchronously in add()
+    std::vector<std::future<void>> jobs;
+    std::mutex mux;
+    std::deque<DecodedLayer> ready;             // decoded, waiting for upload (guarded by mux)
+    std::atomic<int> failed{ 0 };
+    int uploaded = 0;
+
+    // residency
+    bool sparse = false;
+    int tail = 0;                               // levels >= tail = mip tail, committed together
+    std::vector<int> resident;                  // per layer
+    std::vector<std::vector<unsigned char>> backing;    // per layer, CPU copy of chain (sparse only)
+    GLuint lod_buffer = 0;                      // float min LOD per layer
+
+    // upload ring: PBO_SLOTS layers in one persistently mapped buffer, fence per slot
+    static constexpr int PBO_SLOTS = 2;
+    GLuint PBO = 0;
+    unsigned char* pbo_data = nullptr;
+    GLsync pbo_fence[PBO_SLOTS]{};
+    int pbo_next = 0;
+};
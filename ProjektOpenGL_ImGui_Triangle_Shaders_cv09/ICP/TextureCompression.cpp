@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "TextureCompression.hpp"
+
+GLenum gl_internal_format(const TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:                 return GL_RGBA8;
+    }
+}
+
+bool is_compressed(const TextureFormat format)
+{
+    return format != TextureFormat::RGBA8;
+}
+
+size_t level_size(const TextureFormat format, const int width, const int height)
+{
+    // compressed formats are stored in whole 4x4 blocks, also for 2x2 and 1x1 levels
+    const size_t blocks = size_t(std::max(1, (width + 3) / 4)) * std::max(1, (height + 3) / 4);
+    switch (format) {
+    case TextureFormat::BC1: return blocks * 8;
+    case TextureFormat::BC3: return blocks * 16;
+    default:                 return size_t(width) * height * 4;
+    }
+}
+
+//
+// BC1 color block: endpoints on principal axis of block colors, 2-bit index per texel
+//
+static uint16_t to_565(const glm::vec3& c)
+{
+    glm::ivec3 q = glm::clamp(glm::ivec3(glm::round(c * glm::vec3(31.0f, 63.0f, 31.0f) / 255.0f)), glm::ivec3(0), glm::ivec3(31, 63, 31));
+    return uint16_t((q.r << 11) | (q.g << 5) | q.b);
+}
+
+static glm::vec3 from_565(const uint16_t c)
+{
+    return glm::vec3(((c >> 11) & 31) * 255.0f / 31.0f, ((c >> 5) & 63) * 255.0f / 63.0f, (c & 31) * 255.0f / 31.0f);
+}
+
+static void encode_color_block(const uint8_t block[64], uint8_t out[8])
+{
+    glm::vec3 px[16], mean(0.0f);
+    for (int i = 0; i < 16; i++) {
+        px[i] = glm::vec3(block[i * 4], block[i * 4 + 1], block[i * 4 + 2]);
+        mean += px[i];
+    }
+    mean /= 16.0f;
+
+    // principal axis by power iteration on covariance matrix
+    glm::mat3 cov(0.0f);
+    for (auto const& p : px) {
+        glm::vec3 d = p - mean;
+        cov += glm::outerProduct(d, d);
+    }
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for (int it = 0; it < 4; it++) {
+        axis = cov * axis;
+        float len = glm::length(axis);
+        if (len < 1e-6f) {
+            axis = glm::vec3(1.0f);
+            break;
+        }
+        axis /= len;
+    }
+
+    float lo = FLT_MAX, hi = -FLT_MAX;
+    for (auto const& p : px) {
+        float t = glm::dot(p - mean, axis);
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+
+    uint16_t c0 = to_565(mean + axis * hi);
+    uint16_t c1 = to_565(mean + axis * lo);
+    if (c0 < c1)
+        std::swap(c0, c1);      // c0 > c1 = 4-color mode
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        glm::vec3 p0 = from_565(c0), p1 = from_565(c1);
+        glm::vec3 palette[4] = { p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f };
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            float best_d = FLT_MAX;
+            for (int k = 0; k < 4; k++) {
+                glm::vec3 d = px[i] - palette[k];
+                float dist = glm::dot(d, d);
+                if (dist < best_d) {
+                    best_d = dist;
+                    best = k;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+
+    out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);  // little endian
+}
+
+//
+// BC3 alpha block: min/max endpoints, 8 interpolated levels, 3-bit index per texel
+//
+static void encode_alpha_block(const uint8_t block[64], uint8_t out[8])
+{
+    uint8_t a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, block[i * 4 + 3]);
+        a1 = std::min(a1, block[i * 4 + 3]);
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int palette[8] = { a0, a1 };
+        for (int k = 2; k < 8; k++)
+            palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int a = block[i * 4 + 3], best = 0;
+            for (int k = 1; k < 8; k++)
+                if (std::abs(a - palette[k]) < std::abs(a - palette[best]))
+                    best = k;
+            indices |= uint64_t(best) << (3 * i);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = uint8_t(indices >> (8 * b));
+}
+
+void bc_encode(const TextureFormat format, const uint8_t* rgba, const int width, const int height, uint8_t* out, ThreadPool* pool)
+{
+    if (!is_compressed(format))
+        throw std::runtime_error("bc_encode: format is not block compressed.");
+
+    const int blocks_x = std::max(1, (width + 3) / 4), blocks_y = std::max(1, (height + 3) / 4);
+    const size_t block_bytes = (format == TextureFormat::BC1) ? 8 : 16;
+
+    auto encode_row = [&](size_t by) {
+        uint8_t block[64];
+        uint8_t* dst = out + by * blocks_x * block_bytes;
+        for (int bx = 0; bx < blocks_x; bx++) {
+            // gather 4x4 texels, edges of small levels are clamped
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++) {
+                    int sx = std::min(bx * 4 + x, width - 1), sy = std::min(int(by) * 4 + y, height - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+                }
+            if (format == TextureFormat::BC3) {
+                encode_alpha_block(block, dst);
+                dst += 8;
+            }
+            encode_color_block(block, dst);
+            dst += 8;
+        }
+    };
+
+    if (pool)
+        pool->parallel_for(blocks_y, encode_row);
+    else
+        for (int by = 0; by < blocks_y; by++)
+            encode_row(by);
+}
+
+//
+// DDS container
+//
+namespace {
+    struct DDSPixelFormat {
+        uint32_t size, flags, fourCC, rgb_bit_count, r_mask, g_mask, b_mask, a_mask;
+    };
+    struct DDSHeader {
+        uint32_t size, flags, height, width, pitch_or_linear_size, depth, mip_map_count, reserved1[11];
+        DDSPixelFormat pixel_format;
+        uint32_t caps, caps2, caps3, caps4, reserved2;
+    };
+    static_assert(sizeof(DDSHeader) == 124, "DDS header must have 124 bytes");
+
+    constexpr uint32_t fourcc(const char (&s)[5]) { return uint32_t(s[0]) | uint32_t(s[1]) << 8 | uint32_t(s[2]) << 16 | uint32_t(s[3]) << 24; }
+    constexpr uint32_t DDS_MAGIC = fourcc("DDS ");
+
+    uint32_t format_fourcc(const TextureFormat format) { return format == TextureFormat::BC1 ? fourcc("DXT1") : fourcc("DXT5"); }
+}
+
+bool dds_write(const std::filesystem::path& path, const TextureFormat format, const int size, const int levels, const std::vector<uint8_t>& data)
+{
+    DDSHeader header{};
+    header.size = sizeof(DDSHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;     // CAPS, HEIGHT, WIDTH, PIXELFORMAT, MIPMAPCOUNT, LINEARSIZE
+    header.height = header.width = size;
+    header.pitch_or_linear_size = (uint32_t)level_size(format, size, size);
+    header.mip_map_count = levels;
+    header.pixel_format.size = sizeof(DDSPixelFormat);
+    header.pixel_format.flags = 0x4;                                    // FOURCC
+    header.pixel_format.fourCC = format_fourcc(format);
+    header.caps = 0x1000 | 0x8 | 0x400000;                              // TEXTURE, COMPLEX, MIPMAP
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), 4);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return bool(file);
+}
+
+bool dds_read(const std::filesystem::path& path, const TextureFormat format, const int size, const int levels, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint32_t magic = 0;
+    DDSHeader header{};
+    file.read(reinterpret_cast<char*>(&magic), 4);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || magic != DDS_MAGIC || header.pixel_format.fourCC != format_fourcc(format) ||
+        header.width != (uint32_t)size || header.height != (uint32_t)size || header.mip_map_count != (uint32_t)levels)
+        return false;   // missing or made for different layer size/format -> encode again
+
+    size_t bytes = 0;
+    for (int level = 0, s = size; level < levels; level++, s = std::max(1, s / 2))
+        bytes += level_size(format, s, s);
+
+    data.resize(bytes);
+    file.read(reinterpret_cast<char*>(data.data()), bytes);
+    return bool(file);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ThreadPool.hpp"
+
+// GPU formats of TextureArray layers
+enum class TextureFormat {
+    RGBA8,      // uncompressed, 4 B/texel
+    BC1,        // DXT1, RGB, 0.5 B/texel (8x smaller)
+    BC3,        // DXT5, RGBA, 1 B/texel (4x smaller)
+};
+
+GLenum gl_internal_format(const TextureFormat format);
+bool is_compressed(const TextureFormat format);
+size_t level_size(const TextureFormat format, const int width, const int height);      // bytes of one mip level
+
+// CPU block compression of RGBA8 image (rows of 4x4 blocks are spread over pool, if any).
+// out must have level_size(format, width, height) bytes.
+void bc_encode(const TextureFormat format, const uint8_t* rgba, const int width, const int height, uint8_t* out, ThreadPool* pool);
+
+// Import cache: full mip chain of one square texture in DDS container (legacy header, DXT1/DXT5 FourCC).
+// Rows are stored bottom-up (as uploaded to GL), not top-down as DDS tools expect.
+bool dds_write(const std::filesystem::path& path, const TextureFormat format, const int size, const int levels, const std::vector<uint8_t>& data);
+bool dds_read(const std::filesystem::path& path, const TextureFormat format, const int size, const int levels, std::vector<uint8_t>& data);
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "TextureResidency.hpp"
+
+void TextureResidency::add(TextureArray& array)
+{
+    arrays.push_back(&array);
+    if (!array.is_sparse())
+        return;     // always fully resident, counts into budget only
+
+    for (int layer = 0; layer < array.layers(); layer++) {
+        index[{ &array, layer }] = layer_states.size();
+        layer_states.push_back({ &array, layer, array.tail_level(), 0 });
+    }
+}
+
+void TextureResidency::touch(TextureArray& array, const int layer, const float screen_pixels, const unsigned long long frame)
+{
+    auto it = index.find({ &array, layer });
+    if (it == index.end())
+        return;
+    LayerState& state = layer_states[it->second];
+
+    // level whose size is closest to screen size from above (texels >= pixels)
+    const float ratio = array.size() / std::max(screen_pixels, 1.0f);
+    const int level = std::clamp(int(std::floor(std::log2(std::max(ratio, 1.0f)))), 0, array.levels() - 1);
+
+    // several objects with the same texture -> the largest one decides
+    state.wanted = (state.last_used == frame) ? std::min(state.wanted, level) : level;
+    state.last_used = frame;
+}
+
+TextureResidency::LayerState* TextureResidency::victim(const unsigned long long frame, const LayerState* keep)
+{
+    // least recently used layer with something above mip tail;
+    // layers used in this frame only if they have more detail than they need
+    LayerState* best = nullptr;
+    for (LayerState& state : layer_states) {
+        const int resident = state.array->resident_level(state.layer);
+        if (&state == keep || resident >= state.array->tail_level())
+            continue;
+        if (state.last_used == frame && resident >= state.wanted)
+            continue;
+        if (!best || state.last_used < best->last_used ||
+            (state.last_used == best->last_used && resident < best->array->resident_level(best->layer)))
+            best = &state;
+    }
+    return best;
+}
+
+void TextureResidency::update(const unsigned long long frame, const double budget_ms)
+{
+    const auto start = std::chrono::steady_clock::now();
+    size_t used = resident_bytes();
+
+    auto evict = [&](LayerState* state) {
+        used -= state->array->level_bytes(state->array->resident_level(state->layer));
+        state->array->evict(state->layer);
+        evicted++;
+    };
+
+    // budget lowered (or new layers) -> back under budget first
+    while (used > budget) {
+        LayerState* state = victim(frame, nullptr);
+        if (!state)
+            break;
+        evict(state);
+    }
+
+    // visible layers with less detail than their screen size needs, the largest difference first
+    std::vector<LayerState*> candidates;
+    for (LayerState& state : layer_states)
+        if (state.last_used == frame && state.array->resident_level(state.layer) > state.wanted && state.array->can_stream_in(state.layer))
+            candidates.push_back(&state);
+    std::sort(candidates.begin(), candidates.end(), [](const LayerState* a, const LayerState* b) {
+        return a->array->resident_level(a->layer) - a->wanted > b->array->resident_level(b->layer) - b->wanted;
+    });
+
+    // one level per layer and frame, at least one upload
+    int count = 0;
+    for (LayerState* state : candidates) {
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (count > 0 && elapsed >= budget_ms)
+            break;
+
+        const size_t needed = state->array->level_bytes(state->array->resident_level(state->layer) - 1);
+        LayerState* other = nullptr;
+        while (used + needed > budget && (other = victim(frame, state)) != nullptr)
+            evict(other);
+        if (used + needed > budget)
+            continue;   // everything else is needed more
+
+        if (state->array->stream_in(state->layer)) {
+            used += needed;
+            streamed_in++;
+            count++;
+        }
+    }
+}
+
+size_t TextureResidency::resident_bytes(void) const
+{
+    size_t total = 0;
+    for (const TextureArray* array : arrays)
+        total += array->resident_bytes();
+    return total;
+}
+
+void TextureResidency::clear(void)
+{
+    arrays.clear();
+    layer_states.clear();
+    index.clear();
+}
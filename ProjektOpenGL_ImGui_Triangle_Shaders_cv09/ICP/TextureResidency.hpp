@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "TextureArray.hpp"
+
+// GPU memory budget for texture arrays.
+// Application reports every frame how large (in pixels on screen) each used texture layer is,
+// that gives the finest mip level worth having. update() then streams missing levels in
+// (one level of one layer at a time, within a time budget) and, when the resident bytes
+// exceed the budget, evicts finest levels of least recently used layers.
+// Mip tail of every layer is always resident, so anything can be drawn at any time.
+// Only sparse arrays (TextureArray::is_sparse()) are managed, other arrays just count into the budget.
+class TextureResidency {
+public:
+    struct LayerState {
+        TextureArray* array;
+        int layer;
+        int wanted;                         // finest useful level (by screen size in the last frame it was used)
+        unsigned long long last_used;       // frame number, 0 = never
+    };
+
+    TextureResidency(void) = default;
+    explicit TextureResidency(const size_t budget) : budget(budget) {}
+
+    size_t budget = 0;                      // bytes, all arrays together
+
+    void add(TextureArray& array);          // after array.upload()
+
+    // layer is visible in this frame, screen_pixels = its approximate size on screen
+    void touch(TextureArray& array, const int layer, const float screen_pixels, const unsigned long long frame);
+
+    // render thread, once per frame after all touch() calls
+    void update(const unsigned long long frame, const double budget_ms);
+
+    size_t resident_bytes(void) const;
+    const std::vector<LayerState>& states(void) const { return layer_states; }
+
+    unsigned long streamed_in = 0;          // levels, since start
+    unsigned long evicted = 0;
+
+    void clear(void);
+
+private:
+    LayerState* victim(const unsigned long long frame, const LayerState* keep);
+
+    std::vector<TextureArray*> arrays;
+    std::vector<LayerState> layer_states;
+    std::map<std::pair<const TextureArray*, int>, size_t> index;    // (array, layer) -> layer_states
+};
@@ -0,0 +1,78 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(const unsigned threads)
+{
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& w : workers)
+        w.join();
+}
+
+void ThreadPool::parallel_for(const size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+        return;     // nothing to do (helpers below would underflow)
+
+    struct Shared {
+        std::atomic<size_t> next{ 0 };
+        size_t done = 0;
+        std::mutex mux;
+        std::condition_variable cv;
+    };
+    auto shared = std::make_shared<Shared>();
+
+    // helper started after everything was claimed does nothing (body is not touched any more)
+    auto run = [shared, count, &body]() {
+        size_t i, finished = 0;
+        while ((i = shared->next++) < count) {
+            body(i);
+            finished++;
+        }
+        if (finished > 0) {
+            std::lock_guard<std::mutex> lock(shared->mux);
+            shared->done += finished;
+            if (shared->done == count)
+                shared->cv.notify_all();
+        }
+    };
+
+    const size_t helpers = std::min(count, workers.size() + 1) - 1;
+    if (helpers > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            for (size_t h = 0; h < helpers; h++)
+                jobs.emplace_back(run);
+        }
+        cv.notify_all();
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(shared->mux);
+    shared->cv.wait(lock, [&] { return shared->done == count; });
+}
+
+void ThreadPool::worker_loop(void)
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;     // stopping and nothing left to do
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing queued jobs (texture decoding, ...).
+// Destructor finishes queued jobs, then joins the workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(const unsigned threads = default_threads());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queue job, the future is ready when it finishes (exception is rethrown by future.get())
+    template <typename F>
+    std::future<void> submit(F&& job) {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(job));
+        std::future<void> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            jobs.emplace_back([task]() { (*task)(); });
+        }
+        cv.notify_one();
+        return result;
+    }
+
+    // body(0) ... body(count - 1) spread over workers, returns when all are done (count 0 = no-op).
+    // Calling thread takes part and never waits for a job that has not started,
+    // so it is safe to call from a job running on this pool.
+    void parallel_for(const size_t count, const std::function<void(size_t)>& body);
+
+    size_t size(void) const { return workers.size(); }
+
+    // all cores except the one running render loop (hardware_concurrency() may be 0 = unknown)
+    static unsigned default_threads(void) { return std::max(2u, std::thread::hardware_concurrency()) - 1; }
+
+private:
+    void worker_loop(void);
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mux;
+    std::condition_variable cv;
+    bool stopping = false;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free single producer / single consumer triple buffer with latest-value semantics.
+// Producer fills write_buffer() and publish()es it, consumer calls update() and reads read_buffer().
+// Three buffers: one owned by each side plus the one in the middle, exchanged by one atomic swap,
+// so neither side ever waits for the other and nothing is allocated after construction.
+// Values published faster than consumed are overwritten (see skipped()).
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer(void) = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // setup only, before producer and consumer start (e.g. preallocate all three buffers)
+    template <typename F>
+    void for_each_buffer(F&& f) {
+        for (Slot& slot : slots)
+            f(slot.value);
+    }
+
+    // producer
+    T& write_buffer(void) { return slots[write_index].value; }
+    void publish(void) {
+        slots[write_index].sequence = ++published;
+        // release: value written above is visible to consumer which acquires this index
+        write_index = middle.exchange(write_index | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // consumer: true if a newer value was published since last update(), read_buffer() is then the newest one
+    bool update(void) {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        const unsigned long long last = slots[read_index].sequence;
+        read_index = middle.exchange(read_index, std::memory_order_acq_rel) & INDEX;
+        overwritten += slots[read_index].sequence - last - 1;
+        return true;
+    }
+    T& read_buffer(void) { return slots[read_index].value; }
+    const T& read_buffer(void) const { return slots[read_index].value; }
+    unsigned long long sequence(void) const { return slots[read_index].sequence; }     // 0 = nothing published yet
+
+    unsigned long long skipped(void) const { return overwritten; }     // published but never seen by consumer
+
+private:
+    static constexpr unsigned INDEX = 3;
+    static constexpr unsigned FRESH = 4;    // middle buffer holds value not seen by consumer
+
+    struct Slot {
+        T value{};
+        unsigned long long sequence = 0;
+    };
+    Slot slots[3];
+
+    // each side on its own cache line, they are written by different threads
+    alignas(64) std::atomic<unsigned> middle{ 1 };
+    alignas(64) unsigned write_index = 0;
+    unsigned long long published = 0;
+    alignas(64) unsigned read_index = 2;
+    unsigned long long overwritten = 0;
+};
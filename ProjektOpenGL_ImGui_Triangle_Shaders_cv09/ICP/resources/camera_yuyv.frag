@@ -0,0 +1,21 @@
+#version 460 core
+
+// Raw YUYV (YUY2) camera frame -> RGB, with deferred.vert (fullscreen triangle), see CameraTexture.hpp
+// One source texel holds two horizontal pixels: r = Y0, g = U, b = Y1, a = V.
+
+layout (binding = 0) uniform sampler2D yuyv;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 texel = texelFetch(yuyv, ivec2(pixel.x >> 1, pixel.y), 0);
+
+    // BT.601, limited range (same as cv::COLOR_YUV2BGR_YUYV)
+    float y = 1.164 * (((pixel.x & 1) == 0 ? texel.r : texel.b) - 16.0 / 255.0);
+    float u = texel.g - 128.0 / 255.0;
+    float v = texel.a - 128.0 / 255.0;
+
+    FragColor = vec4(clamp(vec3(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u), 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 460 core
+
+// Fullscreen triangle without vertex buffer: glDrawArrays(GL_TRIANGLES, 0, 3) with empty VAO.
+// Used by lighting pass of deferred path (lighting.frag with FEATURE_DEFERRED).
+
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
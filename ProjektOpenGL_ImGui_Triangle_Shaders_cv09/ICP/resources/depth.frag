@@ -0,0 +1,8 @@
+#version 460 core
+
+// Depth pre-pass (with lighting.vert): no color output, only depth is written.
+// Main pass then shades each pixel once with depth test GL_EQUAL.
+
+void main()
+{
+}
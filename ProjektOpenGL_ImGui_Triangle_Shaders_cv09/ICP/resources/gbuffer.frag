@@ -0,0 +1,31 @@
+#version 460 core
+
+// G-buffer pass of deferred path (with lighting.vert): only surface attributes are written,
+// lighting is done per pixel by lighting.frag with FEATURE_DEFERRED (see GBuffer.hpp).
+//   FEATURE_TEXTURE
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+flat in int Layer;
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+
+#ifdef FEATURE_TEXTURE
+layout (binding = 0) uniform sampler2DArray texture_diffuse;
+layout (std430, binding = 9) readonly buffer LayerMinLod { float layer_min_lod[]; };   // see TextureArray.hpp
+#else
+uniform vec4 materialColor;
+#endif
+
+void main()
+{
+#ifdef FEATURE_TEXTURE
+    float lod = max(textureQueryLod(texture_diffuse, TexCoord).y, layer_min_lod[Layer]);
+    gAlbedo = textureLod(texture_diffuse, vec3(TexCoord, Layer), lod);
+#else
+    gAlbedo = materialColor;
+#endif
+    gNormal = vec4(normalize(Normal), 0.0);
+}
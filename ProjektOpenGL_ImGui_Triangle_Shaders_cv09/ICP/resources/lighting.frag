@@ -1,51 +1,149 @@
 #version 460 core
 
+// Permutations: ShaderProgram injects "#define FEATURE_xxx" (see ShaderVariants.hpp),
+// disabled features are not compiled in at all.
+//   FEATURE_DIRLIGHT, FEATURE_SPECULAR, FEATURE_SPOTLIGHT, FEATURE_TEXTURE, FEATURE_ALPHA
+//   FEATURE_CLUSTERED, FEATURE_DEFERRED
+//   (FEATURE_INSTANCED changes only the vertex shader)
+
+#ifdef FEATURE_DEFERRED
+// Deferred lighting pass (with deferred.vert): surface is read from G-buffer, see GBuffer.hpp
+layout (binding = 4) uniform sampler2D gAlbedo;
+layout (binding = 5) uniform sampler2D gNormal;
+layout (binding = 6) uniform sampler2D gDepth;
+uniform mat4 uInvViewProj;     // depth -> world position
+
+vec3 FragPos;
+vec3 Normal;
+#else
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+flat in int Layer;
+#endif
 
 out vec4 FragColor;
 
-uniform sampler2D texture_diffuse;
+#ifdef FEATURE_TEXTURE
+layout (binding = 0) uniform sampler2DArray texture_diffuse;    // all textures = layers of one array
+layout (std430, binding = 9) readonly buffer LayerMinLod { float layer_min_lod[]; };   // finest resident level, see TextureArray.hpp
+#else
+uniform vec4 materialColor;
+#endif
 
 // Ambient light
 uniform vec3 ambientColor;
 
+#ifdef FEATURE_DIRLIGHT
 // Directional light
 uniform vec3 dirLightDirection;
 uniform vec3 dirLightColor;
+layout (binding = 7) uniform sampler2DShadow dirShadowMap;   // cached, see ShadowMap.hpp
+uniform mat4 uDirLightSpace;
+#endif
 
+#ifdef FEATURE_SPOTLIGHT
 // Spotlight
 uniform vec3 spotPos;
 uniform vec3 spotDir;
 uniform float spotCutOff;
 uniform float spotOuterCutOff;
 uniform vec3 spotColor;
+layout (binding = 8) uniform sampler2DShadow spotShadowMap;
+uniform mat4 uSpotLightSpace;
+#endif
 
+#if defined(FEATURE_DIRLIGHT) || defined(FEATURE_SPOTLIGHT)
+// 1 = lit, 0 = in shadow; 4 taps of hardware 2x2 PCF
+float shadow(sampler2DShadow map, mat4 lightSpace, vec3 worldPos)
+{
+    vec4 p = lightSpace * vec4(worldPos, 1.0);
+    vec3 coord = p.xyz / p.w * 0.5 + 0.5;
+    if (p.w <= 0.0 || coord.z > 1.0)
+        return 1.0;
+
+    vec2 texel = 1.0 / vec2(textureSize(map, 0));
+    float lit = 0.0;
+    lit += texture(map, vec3(coord.xy + vec2(-0.5, -0.5) * texel, coord.z));
+    lit += texture(map, vec3(coord.xy + vec2( 0.5, -0.5) * texel, coord.z));
+    lit += texture(map, vec3(coord.xy + vec2(-0.5,  0.5) * texel, coord.z));
+    lit += texture(map, vec3(coord.xy + vec2( 0.5,  0.5) * texel, coord.z));
+    return lit * 0.25;
+}
+#endif
+
+#ifdef FEATURE_CLUSTERED
+// Clustered point/spot lights (see LightClusters.hpp)
+struct Light {
+    vec4 position_range;    // xyz = position, w = range
+    vec4 color;
+    vec4 direction_inner;   // spot: xyz = direction, w = cos(inner angle); point light: w < -1
+    vec4 outer;             // x = cos(outer angle)
+};
+layout (std430, binding = 1) readonly buffer Lights { Light lights[]; };
+layout (std430, binding = 2) readonly buffer Clusters { uvec2 clusters[]; };     // offset, count
+layout (std430, binding = 3) readonly buffer LightIndices { uint light_indices[]; };
+
+uniform uvec3 uClusterGrid;     // tiles x, tiles y, depth slices
+uniform vec2 uClusterDepth;     // near, far plane
+#endif
+
+#if defined(FEATURE_CLUSTERED) || defined(FEATURE_DEFERRED)
+uniform vec2 uViewport;         // framebuffer size
+#endif
+
+#if defined(FEATURE_DIRLIGHT) && defined(FEATURE_SPECULAR)
 // View position (camera)
 uniform vec3 viewPos;
+#endif
 
 void main()
 {
+#ifdef FEATURE_DEFERRED
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float fragDepth = texelFetch(gDepth, pixel, 0).r;
+    if (fragDepth == 1.0)
+        discard;    // background, nothing was rendered here
+
+    vec4 texColor = texelFetch(gAlbedo, pixel, 0);
+    Normal = texelFetch(gNormal, pixel, 0).xyz;
+    vec4 worldPos = uInvViewProj * vec4(gl_FragCoord.xy / uViewport * 2.0 - 1.0, fragDepth * 2.0 - 1.0, 1.0);
+    FragPos = worldPos.xyz / worldPos.w;
+#else
+    float fragDepth = gl_FragCoord.z;
+
+#ifdef FEATURE_TEXTURE
     // Texturovaný materiál
-    vec4 texColor = texture(texture_diffuse, TexCoord); // <-- bereme texColor i s alpha!
+    // nenahrané mip úrovně se nesmí vzorkovat -> LOD omezený na rezidentní úroveň vrstvy
+    float lod = max(textureQueryLod(texture_diffuse, TexCoord).y, layer_min_lod[Layer]);
+    vec4 texColor = textureLod(texture_diffuse, vec3(TexCoord, Layer), lod); // <-- bereme texColor i s alpha!
+#else
+    vec4 texColor = materialColor;
+#endif
+#endif
 
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
 
     // === Ambient ===
-    vec3 ambient = ambientColor * texColor.rgb;
+    vec3 result = ambientColor * texColor.rgb;
 
+#ifdef FEATURE_DIRLIGHT
     // === Directional light ===
     vec3 lightDir = normalize(-dirLightDirection);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * dirLightColor * texColor.rgb;
+    float dirLit = shadow(dirShadowMap, uDirLightSpace, FragPos);
+    result += diff * dirLightColor * texColor.rgb * dirLit;
 
+#ifdef FEATURE_SPECULAR
     // === Specular ===
+    vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = spec * vec3(1.0);
+    result += spec * vec3(1.0) * dirLit;
+#endif
+#endif
 
+#ifdef FEATURE_SPOTLIGHT
     // === Spotlight ===
     vec3 spotLightDir = normalize(spotPos - FragPos);
     float theta = dot(spotLightDir, normalize(-spotDir));
@@ -53,9 +151,41 @@ void main()
     float intensity = clamp((theta - spotOuterCutOff) / epsilon, 0.0, 1.0);
 
     float diffSpot = max(dot(norm, -spotLightDir), 0.0);
-    vec3 spotDiffuse = diffSpot * spotColor * texColor.rgb * intensity;
-
-    vec3 result = ambient + diffuse + specular + spotDiffuse;
-
+    result += diffSpot * spotColor * texColor.rgb * intensity * shadow(spotShadowMap, uSpotLightSpace, FragPos);
+#endif
+
+#ifdef FEATURE_CLUSTERED
+    // === Clustered lights ===
+    // linear view depth from depth buffer value, exponential slice as in LightClusters::build_aabbs()
+    float zNear = uClusterDepth.x, zFar = uClusterDepth.y;
+    float viewZ = 2.0 * zNear * zFar / (zFar + zNear - (2.0 * fragDepth - 1.0) * (zFar - zNear));
+    uint slice = uint(max(log(viewZ / zNear) * float(uClusterGrid.z) / log(zFar / zNear), 0.0));
+    uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / uViewport * vec2(uClusterGrid.xy)), slice), uClusterGrid - 1u);
+    uvec2 cluster_lights = clusters[cluster.x + uClusterGrid.x * (cluster.y + uClusterGrid.y * cluster.z)];
+
+    for (uint i = 0u; i < cluster_lights.y; i++) {
+        Light light = lights[light_indices[cluster_lights.x + i]];
+        vec3 toLight = light.position_range.xyz - FragPos;
+        float dist = length(toLight);
+        toLight /= dist;
+
+        // smooth falloff to zero at range
+        float falloff = clamp(1.0 - (dist * dist) / (light.position_range.w * light.position_range.w), 0.0, 1.0);
+        falloff *= falloff;
+
+        float cone = 1.0;
+        if (light.direction_inner.w >= -1.0) {
+            float theta = dot(-toLight, light.direction_inner.xyz);
+            cone = clamp((theta - light.outer.x) / max(light.direction_inner.w - light.outer.x, 1e-4), 0.0, 1.0);
+        }
+
+        result += max(dot(norm, toLight), 0.0) * light.color.rgb * texColor.rgb * falloff * cone;
+    }
+#endif
+
+#ifdef FEATURE_ALPHA
     FragColor = vec4(result, texColor.a); // <-- zde použijeme průhlednost!
-}
+#else
+    FragColor = vec4(result, 1.0);
+#endif
+}
\ No newline at end of file
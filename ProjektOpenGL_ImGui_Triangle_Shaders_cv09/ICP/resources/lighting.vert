@@ -4,19 +4,43 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
+#ifdef FEATURE_INSTANCED
+// per-instance attributes (MeshBatch, one multi-draw for many objects)
+layout (location = 3) in mat4 aModel;       // locations 3..6
+layout (location = 7) in mat3 aNormalMat;   // locations 7..9
+layout (location = 10) in int aLayer;
+#else
+uniform mat4 uM_m;
+uniform mat3 uN_m;  // normal matrix = transpose(inverse(mat3(uM_m))), computed once per object on CPU
+uniform int uLayer; // layer of texture array
+#endif
+
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+flat out int Layer;
 
-uniform mat4 uM_m;
 uniform mat4 uV_m;
 uniform mat4 uP_m;
 
+// depth pre-pass and main pass (GL_EQUAL) must produce bit-identical depth
+invariant gl_Position;
+
 void main()
 {
-    vec4 worldPos = uM_m * vec4(aPos, 1.0);
+#ifdef FEATURE_INSTANCED
+    mat4 M = aModel;
+    mat3 N = aNormalMat;
+    Layer = aLayer;
+#else
+    mat4 M = uM_m;
+    mat3 N = uN_m;
+    Layer = uLayer;
+#endif
+
+    vec4 worldPos = M * vec4(aPos, 1.0);
     FragPos = vec3(worldPos);
-    Normal = mat3(transpose(inverse(uM_m))) * aNormal;
+    Normal = N * aNormal;
     TexCoord = aTexCoord;
 
     gl_Position = uP_m * uV_m * worldPos;